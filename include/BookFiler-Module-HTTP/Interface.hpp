@@ -117,6 +117,17 @@ public:
 };
 
 using newClientVariantType = std::variant<int, double, std::string>;
+// called with the result code of the request once it finished
+using clientCallbackType = std::function<void(int)>;
+// called with each chunk of the response body, return -1 to abort
+using clientBodyCallbackType = std::function<int(std::string_view)>;
+// called with the body bytes received and the content length, 0 if unknown
+using clientProgressCallbackType =
+    std::function<void(std::uint64_t, std::uint64_t)>;
+/* Fills the buffer with the next part of the request body. Returns the bytes
+ * written, 0 once the body is complete or -1 to abort.
+ */
+using clientBodySourceType = std::function<std::int64_t(char *, std::size_t)>;
 
 class Client {
 public:
@@ -126,12 +137,111 @@ public:
   virtual int setQuery(std::map<std::string, std::string>) = 0;
   virtual int setHeader(std::map<std::string, std::string>) = 0;
   virtual int setMethod(std::string) = 0;
+  /* Request body and its Content-Type. Move the string in to avoid a copy. */
+  virtual int setBody(std::string, std::string) = 0;
+  /* application/x-www-form-urlencoded body */
+  virtual int setForm(std::map<std::string, std::string>) = 0;
+  /* application/json body */
+  virtual int setJson(const rapidjson::Value &) = 0;
+  /* Uploads the file with its Content-Length without loading it in memory */
+  virtual int setBodyFile(std::string, std::string) = 0;
+  /* Uploads the body from the source with chunked encoding. The source runs
+   * on a client thread while the request is sent.
+   */
+  virtual int setBodySource(clientBodySourceType, std::string) = 0;
+  /* Streams the response body to the callback or file instead of keeping it
+   * in memory. getResponseStr() is empty for streamed responses.
+   */
+  virtual int setResponseCallback(clientBodyCallbackType) = 0;
+  virtual int setResponseFile(std::string) = 0;
+  virtual int setProgressCallback(clientProgressCallbackType) = 0;
+  /* Fails the request once the body grows past the size. Responses kept in
+   * memory are limited to 8 MB unless set, streamed ones are not limited.
+   */
+  virtual int setMaxResponseSize(std::uint64_t) = 0;
+  /* Fails the request with -1 if it did not finish within the milliseconds,
+   * retries included. 0 for no deadline.
+   */
+  virtual int setTimeout(int) = 0;
+  /* Retries of idempotent requests after connection errors and 502, 503 or
+   * 504 responses, with jittered exponential backoff.
+   */
+  virtual int setRetries(int) = 0;
+  /* Sends a second copy of an idempotent request once it is slower than most
+   * requests to the host. The first response wins, the other is cancelled.
+   */
+  virtual int setHedge(bool) = 0;
+  /* Identical GET, HEAD and OPTIONS requests in flight at the same time
+   * share one upstream request and its response
+   */
+  virtual int setCoalesce(bool) = 0;
+  /* Sends the requests over the Unix domain socket at the path, with or
+   * without a "unix:" prefix. The URL still gives the Host and the target.
+   */
+  virtual int setUnixSocket(std::string) = 0;
+  /* Sends the requests to an endpoint of the upstream group with the name
+   * from the settings. The endpoint replaces the scheme, host and port of
+   * the URL and a Unix socket set before.
+   */
+  virtual int setUpstreamGroup(std::string) = 0;
   // client methods
+  /* The status code, 0 until a response arrived */
+  virtual int getResponseStatus() = 0;
+  /* A view of the response body for every status. It stays valid until the
+   * next request on this client or the first getResponseJson() call. That
+   * call takes over a body no other client or cache entry shares, after
+   * which the view is empty whether or not the body parsed.
+   */
   virtual std::optional<std::string_view> getResponseStr() = 0;
+  /* Parses the body on the first call and returns the same document after.
+   * Empty if the body is not JSON.
+   */
   virtual std::optional<std::shared_ptr<rapidjson::Document>>
   getResponseJson() = 0;
+  /* Body bytes after gzip or deflate decoding, and as received */
+  virtual std::uint64_t getResponseSize() = 0;
+  virtual std::uint64_t getResponseEncodedSize() = 0;
+  virtual int end() = 0;
+  /* Sends the request on the module's client threads and returns
+   * immediately. The callback runs on a client thread once the request
+   * finished, it may call wait() or send the next request on this client.
+   */
+  virtual int endAsync() = 0;
+  virtual int endAsync(clientCallbackType) = 0;
+  /* Blocks until the request sent with endAsync finished and returns its
+   * result code once the callback finished.
+   */
+  virtual int wait() = 0;
+  /* Cancels the request sent with endAsync, which then finishes with -1 */
+  virtual int cancel() = 0;
+};
+
+using newClientBatchVariantType = std::variant<int, double, std::string>;
+// called with the index and result code of each request as it finishes
+using clientBatchCallbackType = std::function<void(int, int)>;
+
+/* Runs many clients concurrently over the shared connection pool.
+ * Options: "concurrency" caps the requests in flight, "deadline" is the
+ * number of milliseconds after which unfinished requests fail with -1.
+ * The blocking calls return -1 on a client thread.
+ */
+class ClientBatch {
+public:
+  /* Adds a request and returns its index */
+  virtual int add(std::shared_ptr<Client>) = 0;
+  virtual int add(std::map<std::string, newClientVariantType>) = 0;
+  virtual std::shared_ptr<Client> getClient(int) = 0;
+  /* Result code of the request at the index once it finished */
+  virtual int getResult(int) = 0;
+  /* Runs every request and blocks until all finished or the deadline */
   virtual int end() = 0;
   virtual int endAsync() = 0;
+  virtual int endAsync(clientBatchCallbackType) = 0;
+  /* Blocks until another request finished and returns its index, or -1 once
+   * every request was returned.
+   */
+  virtual int next() = 0;
+  /* Blocks until every request finished. Returns -1 if any failed. */
   virtual int wait() = 0;
 };
 
@@ -234,6 +344,12 @@ public:
   virtual std::shared_ptr<Client> newClient() = 0;
   virtual std::shared_ptr<Client>
       newClient(std::map<std::string, newClientVariantType>) = 0;
+  virtual std::shared_ptr<ClientBatch> newClientBatch() = 0;
+  virtual std::shared_ptr<ClientBatch>
+      newClientBatch(std::map<std::string, newClientBatchVariantType>) = 0;
+  /* Statistics shared by all clients, such as the connection pool hit rate.
+   */
+  virtual std::shared_ptr<rapidjson::Document> getClientStats() = 0;
   virtual std::shared_ptr<Url>
       newUrl(std::map<std::string, newUrlVariantType>) = 0;
   virtual std::shared_ptr<Server>
@@ -25,12 +25,14 @@ ModuleExport::ModuleExport() {
   std::shared_ptr<bookfiler::JsonImpl> jsonImpl =
       std::make_shared<bookfiler::JsonImpl>();
   jsonPtr = std::dynamic_pointer_cast<bookfiler::Json>(jsonImpl);
+  clientState = std::make_shared<ClientState>();
 };
 
 ModuleExport::~ModuleExport(){};
 
 int ModuleExport::init() {
   std::cout << moduleName << ": init()" << std::endl;
+  clientState->init();
   return 0;
 }
 
@@ -67,6 +69,8 @@ int ModuleExport::setAccounts(std::shared_ptr<rapidjson::Value> jsonDoc) {
 
 int ModuleExport::setSettings(std::shared_ptr<rapidjson::Value> jsonDoc) {
   settingsDoc = jsonDoc;
+  clientState->setSettingsDoc(settingsDoc);
+  clientState->extractSettings();
 #if MODULE_EXPORT_SET_SETTINGS_DEBUG
   rapidjson::StringBuffer buffer;
   rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
@@ -80,6 +84,7 @@ int ModuleExport::setSettings(std::shared_ptr<rapidjson::Value> jsonDoc) {
 std::shared_ptr<Client> ModuleExport::newClient() {
   std::shared_ptr<ClientImpl> connectionPtr = std::make_shared<ClientImpl>();
   connectionPtr->setSettingsDoc(settingsDoc);
+  connectionPtr->setClientState(clientState);
   // connectionPtr->setAccountsDoc(accountsDoc);
   return std::dynamic_pointer_cast<Client>(connectionPtr);
 }
@@ -88,10 +93,35 @@ std::shared_ptr<Client>
 ModuleExport::newClient(std::map<std::string, newClientVariantType> map) {
   std::shared_ptr<ClientImpl> connectionPtr = std::make_shared<ClientImpl>(map);
   connectionPtr->setSettingsDoc(settingsDoc);
+  connectionPtr->setClientState(clientState);
   // connectionPtr->setAccountsDoc(accountsDoc);
   return std::dynamic_pointer_cast<Client>(connectionPtr);
 }
 
+std::shared_ptr<ClientBatch> ModuleExport::newClientBatch() {
+  std::shared_ptr<ClientBatchImpl> batchPtr =
+      std::make_shared<ClientBatchImpl>();
+  batchPtr->setSettingsDoc(settingsDoc);
+  batchPtr->setClientState(clientState);
+  return std::dynamic_pointer_cast<ClientBatch>(batchPtr);
+}
+
+std::shared_ptr<ClientBatch> ModuleExport::newClientBatch(
+    std::map<std::string, newClientBatchVariantType> map) {
+  std::shared_ptr<ClientBatchImpl> batchPtr =
+      std::make_shared<ClientBatchImpl>(map);
+  batchPtr->setSettingsDoc(settingsDoc);
+  batchPtr->setClientState(clientState);
+  return std::dynamic_pointer_cast<ClientBatch>(batchPtr);
+}
+
+std::shared_ptr<rapidjson::Document> ModuleExport::getClientStats() {
+  std::shared_ptr<rapidjson::Document> statsDoc =
+      std::make_shared<rapidjson::Document>();
+  clientState->getStats(*statsDoc);
+  return statsDoc;
+}
+
 std::shared_ptr<Url>
 ModuleExport::newUrl(std::map<std::string, newUrlVariantType> map_) {
   std::shared_ptr<UrlImpl> urlPtr = std::make_shared<UrlImpl>(map_);
@@ -102,6 +132,7 @@ std::shared_ptr<Server>
 ModuleExport::newServer(std::map<std::string, newServerVariantType> map) {
   std::shared_ptr<ServerImpl> serverPtr = std::make_shared<ServerImpl>();
   serverPtr->setSettingsDoc(settingsDoc);
+  serverPtr->setClientState(clientState);
   return std::dynamic_pointer_cast<Server>(serverPtr);
 }
 
@@ -40,6 +40,8 @@
 
 // Local Project
 #include "core/Client.hpp"
+#include "core/ClientBatch.hpp"
+#include "core/ClientState.hpp"
 #include "core/Server.hpp"
 #include "core/Template.hpp"
 #include "core/json.hpp"
@@ -61,6 +63,7 @@ private:
   std::shared_ptr<rapidjson::Value> accountsDoc;
   std::map<std::string, std::condition_variable> conditionVariableMap;
   std::shared_ptr<bookfiler::Json> jsonPtr;
+  std::shared_ptr<ClientState> clientState;
 
 public:
   ModuleExport();
@@ -91,6 +94,10 @@ public:
   std::shared_ptr<Client> newClient();
   std::shared_ptr<Client>
       newClient(std::map<std::string, newClientVariantType>);
+  std::shared_ptr<ClientBatch> newClientBatch();
+  std::shared_ptr<ClientBatch>
+      newClientBatch(std::map<std::string, newClientBatchVariantType>);
+  std::shared_ptr<rapidjson::Document> getClientStats();
   std::shared_ptr<Url> newUrl(std::map<std::string, newUrlVariantType>);
   std::shared_ptr<Server>
       newServer(std::map<std::string, newServerVariantType>);
@@ -6,6 +6,12 @@
  * @brief HTTP module for BookFiler™ applications.
  */
 
+// C++17
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <limits>
+
 // Local Project
 #include "Client.hpp"
 
@@ -18,7 +24,19 @@ namespace HTTP {
 ClientImpl::ClientImpl() {
   urlPtr = std::make_shared<UrlImpl>();
   method = "GET";
-  skipPeerVerification = skipHostnameVerification = false;
+  asyncFlag = asyncReusedFlag = false;
+  asyncCallbackNum = 0;
+  http2RefusedNum = 0;
+  asyncRc = asyncAttemptNum = 0;
+  maxResponseSize = bodyReceived = bodyEncodedReceived = bodyTotal = 0;
+  bodyBeginFlag = bodyAbortFlag = false;
+  hedgeFlag = false;
+  asyncGeneration = 0;
+  asyncRetryMax = asyncRetryNum = asyncPrimaryRc = 0;
+  asyncCancelFlag = asyncPrimaryFlag = asyncHedgeWonFlag = hedgeRunFlag = false;
+  cacheStoreFlag = cacheValidatorFlag = cacheRevalidateFlag = false;
+  responseFlag = responseJsonFlag = false;
+  coalesceLeaderFlag = false;
   // request
   requestBeast = std::make_shared<
       boost::beast::http::request<boost::beast::http::string_body>>();
@@ -28,8 +46,32 @@ ClientImpl::ClientImpl() {
 ClientImpl::ClientImpl(
     std::map<std::string, newClientVariantType> map) {
   urlPtr = std::make_shared<UrlImpl>();
+  asyncFlag = asyncReusedFlag = false;
+  asyncCallbackNum = 0;
+  http2RefusedNum = 0;
+  asyncRc = asyncAttemptNum = 0;
+  maxResponseSize = bodyReceived = bodyEncodedReceived = bodyTotal = 0;
+  bodyBeginFlag = bodyAbortFlag = false;
+  hedgeFlag = false;
+  asyncGeneration = 0;
+  asyncRetryMax = asyncRetryNum = asyncPrimaryRc = 0;
+  asyncCancelFlag = asyncPrimaryFlag = asyncHedgeWonFlag = hedgeRunFlag = false;
+  cacheStoreFlag = cacheValidatorFlag = cacheRevalidateFlag = false;
+  responseFlag = responseJsonFlag = false;
+  coalesceLeaderFlag = false;
   for (auto val : map) {
     if (int *val_ = std::get_if<int>(&val.second)) {
+      if (val.first == "maxResponseSize") {
+        maxResponseSize = std::max<int>(0, *val_);
+      } else if (val.first == "timeout") {
+        setTimeout(*val_);
+      } else if (val.first == "retries") {
+        setRetries(*val_);
+      } else if (val.first == "hedge") {
+        setHedge(*val_ != 0);
+      } else if (val.first == "coalesce") {
+        setCoalesce(*val_ != 0);
+      }
     } else if (double *val_ = std::get_if<double>(&val.second)) {
     } else if (std::string *val_ = std::get_if<std::string>(&val.second)) {
       if (val.first == "method") {
@@ -42,6 +84,12 @@ ClientImpl::ClientImpl(
         urlPtr->set_scheme(*val_);
       } else if (val.first == "query") {
         urlPtr->setEncodedQuery(*val_);
+      } else if (val.first == "responseFile") {
+        responseFile = *val_;
+      } else if (val.first == "unixSocket") {
+        setUnixSocket(*val_);
+      } else if (val.first == "upstreamGroup") {
+        setUpstreamGroup(*val_);
       }
     }
   }
@@ -68,32 +116,8 @@ int ClientImpl::setSettingsDoc(std::shared_ptr<rapidjson::Value> settingsDoc_) {
   return 0;
 }
 
-int ClientImpl::loadSettingsDoc() {
-  /* Get settings from JSON document */
-  if (!settingsDoc->IsObject()) {
-    std::thread::id threadId = std::this_thread::get_id();
-    std::cout
-        << "\n=== THREAD " << threadId << " ===\n"
-        << moduleCode
-        << "::ClientImpl::loadSettingsDoc ERROR:\nSettings document invalid"
-        << std::endl;
-    return -1;
-  }
-  char memberName01[] = "CaInfoPath";
-  if (settingsDoc->HasMember(memberName01) &&
-      (*settingsDoc)[memberName01].IsString()) {
-    CaInfoPath = (*settingsDoc)[memberName01].GetString();
-  }
-  char memberName02[] = "skipPeerVerification";
-  if (settingsDoc->HasMember(memberName02) &&
-      (*settingsDoc)[memberName02].IsBool()) {
-    skipPeerVerification = (*settingsDoc)[memberName02].GetBool();
-  }
-  char memberName03[] = "skipHostnameVerification";
-  if (settingsDoc->HasMember(memberName03) &&
-      (*settingsDoc)[memberName03].IsBool()) {
-    skipHostnameVerification = (*settingsDoc)[memberName03].GetBool();
-  }
+int ClientImpl::setClientState(std::shared_ptr<ClientState> clientState_) {
+  clientState = clientState_;
   return 0;
 }
 
@@ -129,120 +153,1677 @@ int ClientImpl::setMethod(std::string method_) {
   return 0;
 }
 
-std::unique_ptr<ssl::stream<tcp::socket>>
-ClientImpl::connect(asio::io_context &ctx, ssl::context &ssl_ctx,
-                    std::string const &hostname) {
-  // resolve
-  tcp::resolver resolver{ctx};
-  tcp::resolver::results_type resolved = resolver.resolve(hostname, "https");
+int ClientImpl::setBody(std::string body, std::string contentType) {
+  bodySource = nullptr;
+  bodyFile.clear();
+  requestBeast->body() = std::move(body);
+  if (!contentType.empty()) {
+    requestBeast->set(http::field::content_type, contentType);
+  }
+  return 0;
+}
+
+int ClientImpl::setForm(std::map<std::string, std::string> formMap) {
+  Util util;
+  std::string body;
+  // '+' stands for a space in form data
+  const std::string reservedCharStr = "&=+";
+  for (auto const &formPair : formMap) {
+    if (!body.empty()) {
+      body.append("&");
+    }
+    util.uriEncode(formPair.first, reservedCharStr, body);
+    body.append("=");
+    util.uriEncode(formPair.second, reservedCharStr, body);
+  }
+  return setBody(std::move(body), "application/x-www-form-urlencoded");
+}
+
+int ClientImpl::setJson(const rapidjson::Value &value) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  if (!value.Accept(writer)) {
+    logStatus("::ClientImpl::setJson", "ERROR: could not write the JSON");
+    return -1;
+  }
+  return setBody(std::string(buffer.GetString(), buffer.GetSize()),
+                 "application/json");
+}
+
+int ClientImpl::setBodyFile(std::string path, std::string contentType) {
+  setBody("", contentType);
+  bodyFile = path;
+  return 0;
+}
+
+int ClientImpl::setBodySource(clientBodySourceType source,
+                              std::string contentType) {
+  setBody("", contentType);
+  bodySource = source;
+  return 0;
+}
+
+int ClientImpl::setResponseCallback(clientBodyCallbackType responseCallback_) {
+  responseCallback = responseCallback_;
+  return 0;
+}
+
+int ClientImpl::setResponseFile(std::string responseFile_) {
+  responseFile = responseFile_;
+  return 0;
+}
+
+int ClientImpl::setProgressCallback(
+    clientProgressCallbackType progressCallback_) {
+  progressCallback = progressCallback_;
+  return 0;
+}
+
+int ClientImpl::setMaxResponseSize(std::uint64_t maxResponseSize_) {
+  maxResponseSize = maxResponseSize_;
+  return 0;
+}
+
+int ClientImpl::setTimeout(int timeout_) {
+  timeoutOpt = std::chrono::milliseconds(std::max<int>(0, timeout_));
+  return 0;
+}
+
+int ClientImpl::setRetries(int retries_) {
+  retryMaxOpt = std::max<int>(0, retries_);
+  return 0;
+}
+
+int ClientImpl::setHedge(bool hedgeFlag_) {
+  hedgeFlag = hedgeFlag_;
+  return 0;
+}
+
+int ClientImpl::setCoalesce(bool coalesceFlag_) {
+  coalesceOpt = coalesceFlag_;
+  return 0;
+}
+
+int ClientImpl::setUnixSocket(std::string unixSocketPath_) {
+  if (unixSocketPath_.rfind("unix:", 0) == 0) {
+    unixSocketPath_.erase(0, 5);
+  }
+  unixSocketPath = unixSocketPath_;
+  return 0;
+}
+
+int ClientImpl::setUpstreamGroup(std::string upstreamGroupName_) {
+  upstreamGroupName = upstreamGroupName_;
+  return 0;
+}
+
+int ClientImpl::connect(ClientConnection &connection,
+                        std::string const &hostname, std::string const &port) {
+  boost::system::error_code ec;
+  if (transport == clientTransport::tls) {
+    // shared by every client, the trust store is only loaded on change
+    connection.sslContextPtr = clientState->getSslContext();
+  }
+  connection.streamPtr = std::make_unique<ClientStream>(
+      transport, clientState->ioContext, connection.sslContextPtr.get());
+
+  if (transport == clientTransport::local) {
+    connection.streamPtr->unixSocket()->connect(
+        asio::local::stream_protocol::endpoint(unixSocketPath), ec);
+    if (ec) {
+      logStatus("::ClientImpl::connect", "connect " + unixSocketPath, ec);
+      return -1;
+    }
+    return 0;
+  }
+
+  // resolve through the shared cache
+  const bool waitFlag = clientState->canWaitOnIo();
+  tcp::resolver::results_type resolved;
+  clientState->resolverPtr->resolve(hostname, port, resolved, ec, waitFlag);
+  if (ec) {
+    logStatus("::ClientImpl::connect", "resolve " + hostname, ec);
+    return -1;
+  }
 
-  // socket
-  tcp::socket socket{ctx};
-  asio::connect(socket, resolved);
+  if (waitFlag) {
+    // the client threads race the addresses, this thread only waits
+    auto connectorPtr = std::make_shared<ClientConnector>(
+        clientState->ioContext, settingsPtr->connectStagger);
+    std::promise<void> connectPromise;
+    connectorPtr->start(resolved, [&](boost::system::error_code connectEc,
+                                      tcp::socket socket) {
+      ec = connectEc;
+      if (!connectEc) {
+        *connection.streamPtr->tcpSocket() = std::move(socket);
+      }
+      connectPromise.set_value();
+    });
+    connectPromise.get_future().wait();
+    if (!ec) {
+      countConnect(*connectorPtr);
+    }
+  } else {
+    // nothing would run the race, try the addresses one after another
+    asio::connect(*connection.streamPtr->tcpSocket(), resolved, ec);
+  }
+  if (ec) {
+    logStatus("::ClientImpl::connect", "connect " + hostname, ec);
+    return -1;
+  }
+  if (transport == clientTransport::tcp) {
+    return 0;
+  }
 
-  auto streamPtr =
-      boost::make_unique<ssl::stream<tcp::socket>>(std::move(socket), ssl_ctx);
+  prepareStream(connection);
+  connection.streamPtr->tls()->handshake(
+      ssl::stream_base::handshake_type::client, ec);
+  if (ec) {
+    logStatus("::ClientImpl::connect", "handshake", ec);
+    return -1;
+  }
+  finishHandshake(connection);
+  return 0;
+}
+
+int ClientImpl::prepareStream(ClientConnection &connection) {
   // tag::stream_setup_source[]
-  boost::certify::set_server_hostname(*streamPtr, hostname);
-  boost::certify::sni_hostname(*streamPtr, hostname);
+  ClientStream::tlsStreamType &stream = *connection.streamPtr->tls();
+  if (!settingsPtr->skipHostnameVerification) {
+    boost::certify::set_server_hostname(stream, requestHost);
+  }
+  boost::certify::sni_hostname(stream, requestHost);
   // end::stream_setup_source[]
 
-  streamPtr->handshake(ssl::stream_base::handshake_type::client);
-  return streamPtr;
+  // resume the last session with this host if there is one
+  connection.sessionKey = poolKey;
+  clientState->sessionCachePtr->setSession(stream.native_handle(),
+                                           &connection.sessionKey);
+
+  if (settingsPtr->http2Flag) {
+    static const unsigned char alpnProtos[] = "\x02h2\x08http/1.1";
+    SSL_set_alpn_protos(stream.native_handle(), alpnProtos,
+                        sizeof(alpnProtos) - 1);
+  }
+  return 0;
+}
+
+int ClientImpl::finishHandshake(ClientConnection &connection) {
+  SSL *ssl = connection.streamPtr->tls()->native_handle();
+  clientState->sessionCachePtr->addHandshake(ssl);
+  const unsigned char *alpnData = nullptr;
+  unsigned int alpnLen = 0;
+  SSL_get0_alpn_selected(ssl, &alpnData, &alpnLen);
+  connection.http2Flag =
+      alpnLen == 2 && std::memcmp(alpnData, "h2", 2) == 0;
+  return 0;
+}
+
+void ClientImpl::countConnect(ClientConnector &connector) {
+  clientState->connectNum++;
+  clientState->connectAttemptNum += connector.getAttemptNum();
+  if (connector.winnerIndex > 0) {
+    clientState->connectFallbackNum++;
+  }
+}
+
+std::string ClientImpl::getPoolKey(std::string const &hostname,
+                                   std::string const &port) {
+  if (transport == clientTransport::local) {
+    return "unix:" + unixSocketPath;
+  }
+  return std::string(transport == clientTransport::tls ? "https" : "http") +
+         "://" + hostname + ":" + port;
+}
+
+int ClientImpl::getResponseStatus() {
+  if (!responseFlag) {
+    return 0;
+  }
+  return responseBeast->result_int();
 }
 
 std::optional<std::string_view> ClientImpl::getResponseStr() {
-  if (!responseStr.empty()) {
-    return responseStr;
+  if (!responseFlag || isStreaming()) {
+    return {};
   }
-  return {};
+  return std::string_view(responseBeast->body());
 }
 
 std::optional<std::shared_ptr<rapidjson::Document>>
 ClientImpl::getResponseJson() {
+  // the waiting thread and the callback may both ask for the document
+  const std::lock_guard<std::mutex> lock(asyncMutex);
+  if (!responseJsonFlag) {
+    responseJsonFlag = true;
+    auto responseStrOpt = getResponseStr();
+    if (responseStrOpt && !responseStrOpt->empty()) {
+      auto jsonPtr = std::make_shared<ClientResponseJson>();
+      if (responseBeast.use_count() == 1) {
+        // the document takes over the body, the in situ parse overwrites it
+        jsonPtr->buffer = std::move(responseBeast->body());
+        responseBeast->body().clear();
+      } else {
+        // shared with the response cache or other clients, parse a copy
+        jsonPtr->buffer = *responseStrOpt;
+      }
+      jsonPtr->doc.ParseInsitu(jsonPtr->buffer.data());
+      if (!jsonPtr->doc.HasParseError()) {
+        responseJsonDoc =
+            std::shared_ptr<rapidjson::Document>(jsonPtr, &jsonPtr->doc);
+      }
+    }
+  }
   if (responseJsonDoc) {
     return responseJsonDoc;
   }
   return {};
 }
 
-int ClientImpl::end() {
-  const std::string hostname(urlPtr->getEncodedHost());
+int ClientImpl::prepareRequest() {
+  responseFlag = responseJsonFlag = false;
+  responseJsonDoc.reset();
+  std::string schemeStr(urlPtr->scheme().data(), urlPtr->scheme().size());
+  boost::to_lower(schemeStr);
+  if (!unixSocketPath.empty()) {
+    transport = clientTransport::local;
+  } else if (schemeStr == "http") {
+    transport = clientTransport::tcp;
+  } else if (schemeStr.empty() || schemeStr == "https") {
+    transport = clientTransport::tls;
+  } else {
+    logStatus("::ClientImpl::prepareRequest",
+              "ERROR: unsupported scheme " + schemeStr);
+    return -1;
+  }
+  requestHost = std::string(urlPtr->getEncodedHost());
+  requestPort = std::string(urlPtr->port().data(), urlPtr->port().size());
+  if (requestPort.empty()) {
+    requestPort = transport == clientTransport::tcp ? "80" : "443";
+  }
+  std::string hostHeader = requestHost;
+  upstreamLeasePtr.reset();
+  if (!upstreamGroupName.empty()) {
+    auto groupPtr = clientState->getUpstreamGroup(upstreamGroupName);
+    if (groupPtr) {
+      upstreamLeasePtr = groupPtr->pick();
+    }
+    if (!upstreamLeasePtr) {
+      logStatus("::ClientImpl::prepareRequest",
+                "ERROR: no endpoint in upstream group " + upstreamGroupName);
+      return -1;
+    }
+    ClientUpstream &upstream = *upstreamLeasePtr->upstreamPtr;
+    transport = upstream.transport;
+    unixSocketPath = upstream.unixSocketPath;
+    requestHost = upstream.host;
+    requestPort = upstream.port;
+    hostHeader = upstream.hostHeader;
+  }
+  poolKey = getPoolKey(requestHost, requestPort);
 
   std::thread::id threadId = std::this_thread::get_id();
   std::cout << "\n=== THREAD " << threadId << " ===\n"
             << moduleCode << "::ClientImpl::end Connection Settings:"
-            << "\nhostname: " << hostname << "\nURL: " << urlPtr->url()
+            << "\nhostname: " << requestHost << "\nURL: " << urlPtr->url()
             << "\nURL Field String: " << urlPtr->getEncodedQuery()
             << "\nURL target: " << urlPtr->target()
-            << "\nHTTP Method: " << method << "\nCaInfoPath: " << CaInfoPath
-            << "\nskipPeerVerification: " << skipPeerVerification
-            << "\nskipHostnameVerification: " << skipHostnameVerification
+            << "\nHTTP Method: " << method
+            << "\nCaInfoPath: " << settingsPtr->CaInfoPath
+            << "\nskipPeerVerification: "
+            << settingsPtr->skipPeerVerification
+            << "\nskipHostnameVerification: "
+            << settingsPtr->skipHostnameVerification
             << std::endl;
 
-  asio::io_context ctx;
-  ssl::context ssl_ctx{ssl::context::tls_client};
-  ssl_ctx.set_verify_mode(ssl::context::verify_peer |
-                          ssl::context::verify_fail_if_no_peer_cert);
-  ssl_ctx.set_default_verify_paths();
-  // tag::ctx_setup_source[]
-  boost::certify::enable_native_https_server_verification(ssl_ctx);
-  // end::ctx_setup_source[]
-  std::unique_ptr<ssl::stream<tcp::socket>> streamPtr =
-      connect(ctx, ssl_ctx, hostname);
-
-  // response
-  responseBeast = std::make_shared<
-      boost::beast::http::response<boost::beast::http::string_body>>();
-  responsePtr = std::make_shared<ResponseImpl>();
-  responsePtr->setResponse(responseBeast);
-
-  if (method == "POST") {
-    requestBeast->method(http::verb::post);
-  } else {
-    requestBeast->method(http::verb::get);
+  http::verb verb = http::string_to_verb(method);
+  if (verb == http::verb::unknown) {
+    verb = http::verb::get;
+  }
+  requestBeast->method(verb);
+  // the path of the endpoint URL goes in front of the request's
+  requestBeast->target(
+      upstreamLeasePtr
+          ? upstreamLeasePtr->upstreamPtr->pathPrefix + urlPtr->target()
+          : urlPtr->target());
+  requestBeast->keep_alive(true);
+  requestBeast->set(http::field::host, hostHeader);
+  if (settingsPtr->decodeFlag &&
+      requestBeast->find(http::field::accept_encoding) == requestBeast->end()) {
+    requestBeast->set(http::field::accept_encoding, "gzip, deflate");
+  }
+  if (prepareBody() < 0) {
+    return -1;
   }
-  requestBeast->target(urlPtr->target());
-  requestBeast->keep_alive(false);
-  requestBeast->set(http::field::host, hostname);
 
 #if BOOKFILER_HTTP_CLIENT_END_DEBUG_RESPONSE
   std::cout << "\n=== THREAD " << threadId << " ===\n"
             << moduleCode << "::ClientImpl::end request:\n"
             << *requestBeast << std::endl;
 #endif
+  return 0;
+}
 
-  http::write(*streamPtr, *requestBeast);
+int ClientImpl::prepareBody() {
+  if (!bodyFile.empty()) {
+    boost::system::error_code ec;
+    if (bodyFileBeast.is_open()) {
+      bodyFileBeast.close(ec);
+    }
+    bodyFileBeast.open(bodyFile.c_str(), beast::file_mode::scan, ec);
+    if (!ec) {
+      bodyFileRemaining = bodyFileBeast.size(ec);
+    }
+    if (ec) {
+      logStatus("::ClientImpl::prepareBody", "open " + bodyFile, ec);
+      return -1;
+    }
+    requestBeast->content_length(bodyFileRemaining);
+  } else if (bodySource) {
+    requestBeast->chunked(true);
+  } else {
+    // Content-Length, also 0 for a POST without body
+    requestBeast->prepare_payload();
+  }
+  return 0;
+}
+
+bool ClientImpl::isUploading() { return bodySource || !bodyFile.empty(); }
 
-  beast::flat_buffer buffer;
-  http::read(*streamPtr, buffer, *responseBeast);
+std::int64_t ClientImpl::readUpload(char *data, std::size_t len) {
+  if (bodySource) {
+    return bodySource(data, len);
+  }
+  if (bodyFileRemaining == 0) {
+    boost::system::error_code ec;
+    bodyFileBeast.close(ec);
+    return 0;
+  }
+  boost::system::error_code ec;
+  len = static_cast<std::size_t>(
+      std::min<std::uint64_t>(len, bodyFileRemaining));
+  std::size_t readLen = bodyFileBeast.read(data, len, ec);
+  if (ec || readLen == 0) {
+    // the file shrank below the Content-Length that was sent
+    logStatus("::ClientImpl::readUpload", "read " + bodyFile, ec);
+    return -1;
+  }
+  bodyFileRemaining -= readLen;
+  return static_cast<std::int64_t>(readLen);
+}
 
-  if (responseBeast->result() == boost::beast::http::status::ok) {
-    responseStr = responseBeast->body();
-    // Try to parse the response as JSON
-    responseJsonDoc = std::make_shared<rapidjson::Document>();
-    rapidjson::ParseResult ok =
-        responseJsonDoc->Parse(responseBeast->body().c_str());
-    if (!ok) {
-      responseJsonDoc.reset();
+int ClientImpl::writeRequest(ClientStream &stream,
+                             boost::system::error_code &ec) {
+  if (!isUploading()) {
+    http::write(stream, *requestBeast, ec);
+    return ec ? -1 : 0;
+  }
+  http::request_serializer<http::string_body> serializer(*requestBeast);
+  http::write_header(stream, serializer, ec);
+  uploadBuffer.resize(65536);
+  while (!ec) {
+    std::int64_t len = readUpload(uploadBuffer.data(), uploadBuffer.size());
+    if (len < 0) {
+      ec = asio::error::operation_aborted;
+    } else if (requestBeast->chunked()) {
+      if (len == 0) {
+        asio::write(stream, http::make_chunk_last(), ec);
+        break;
+      }
+      asio::write(stream,
+                  http::make_chunk(asio::buffer(uploadBuffer.data(), len)),
+                  ec);
+    } else if (len == 0) {
+      break;
+    } else {
+      asio::write(stream, asio::buffer(uploadBuffer.data(), len), ec);
     }
   }
+  return ec ? -1 : 0;
+}
+
+int ClientImpl::newResponse() {
+  responseBeast = std::make_shared<
+      boost::beast::http::response<boost::beast::http::string_body>>();
+  responsePtr = std::make_shared<ResponseImpl>();
+  responsePtr->setResponse(responseBeast);
+  responseFlag = responseJsonFlag = false;
+  responseJsonDoc.reset();
+  finishBody();
+  bodyReceived = bodyEncodedReceived = bodyTotal = 0;
+  bodyBeginFlag = bodyAbortFlag = false;
+  parserPtr = std::make_shared<http::response_parser<http::buffer_body>>();
+  // deliverBody enforces maxResponseSize
+  parserPtr->body_limit(std::numeric_limits<std::uint64_t>::max());
+  // a HEAD response announces a body it never sends, RFC 7230 3.3.3
+  parserPtr->skip(requestBeast->method() == http::verb::head);
+  bodyBuffer.resize(65536);
+  return 0;
+}
+
+bool ClientImpl::isStreaming() {
+  return responseCallback || !responseFile.empty();
+}
+
+bool ClientImpl::isRetryable() {
+  // a streamed body can not be read again
+  return bodyReceived == 0 && !bodyAbortFlag && !isUploading() &&
+         isIdempotent();
+}
+
+bool ClientImpl::isIdempotent() {
+  switch (requestBeast->method()) {
+  case http::verb::get:
+  case http::verb::head:
+  case http::verb::put:
+  case http::verb::delete_:
+  case http::verb::options:
+  case http::verb::trace:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ClientImpl::isRetryStatus() {
+  if (isStreaming()) {
+    return false;
+  }
+  const unsigned status = responseBeast->result_int();
+  return status == 502 || status == 503 || status == 504;
+}
+
+void ClientImpl::addPoolSample(bool failFlag) {
+  bool dropFlag = failFlag, errorFlag = failFlag;
+  if (!failFlag) {
+    const unsigned status = responseBeast->result_int();
+    dropFlag = status == 429 || status == 503;
+    errorFlag = status >= 500;
+  }
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - poolSampleTime);
+  clientState->poolPtr->addSample(poolKey, latency, dropFlag);
+  if (upstreamLeasePtr) {
+    upstreamLeasePtr->addSample(latency, errorFlag);
+  }
+}
+
+int ClientImpl::readResponse(ClientStream &stream, beast::flat_buffer &buffer,
+                             boost::system::error_code &ec) {
+  http::response_parser<http::buffer_body> &parser = *parserPtr;
+  http::read_header(stream, buffer, parser, ec);
+  if (ec) {
+    return -1;
+  }
+  responseBeast->base() = parser.get().base();
+  while (!parser.is_done()) {
+    parser.get().body().data = bodyBuffer.data();
+    parser.get().body().size = bodyBuffer.size();
+    http::read(stream, buffer, parser, ec);
+    if (ec == http::error::need_buffer) {
+      ec = {};
+    }
+    if (ec) {
+      finishBody();
+      return -1;
+    }
+    if (deliverBody(bodyBuffer.data(),
+                    bodyBuffer.size() - parser.get().body().size) < 0) {
+      ec = asio::error::operation_aborted;
+      finishBody();
+      return -1;
+    }
+  }
+  if (finishBody() < 0) {
+    // the message ended inside the compressed stream
+    ec = http::error::partial_message;
+    return -1;
+  }
+  return 0;
+}
+
+int ClientImpl::deliverBody(const char *data, std::size_t len) {
+  if (!bodyBeginFlag) {
+    bodyBeginFlag = true;
+    auto it = responseBeast->find(http::field::content_length);
+    if (it != responseBeast->end()) {
+      bodyTotal = std::strtoull(std::string(it->value()).c_str(), nullptr, 10);
+    }
+    it = responseBeast->find(http::field::content_encoding);
+    if (settingsPtr->decodeFlag && it != responseBeast->end()) {
+      std::string contentEncoding(it->value());
+      std::transform(contentEncoding.begin(), contentEncoding.end(),
+                     contentEncoding.begin(), ::tolower);
+      if (decoder.begin(contentEncoding) < 0) {
+        bodyAbortFlag = true;
+        return -1;
+      }
+    }
+    if (responseCallback) {
+    } else if (!responseFile.empty()) {
+      boost::system::error_code ec;
+      responseFileBeast.open(responseFile.c_str(), beast::file_mode::write,
+                             ec);
+      if (ec) {
+        logStatus("::ClientImpl::deliverBody", "open " + responseFile, ec);
+        bodyAbortFlag = true;
+        return -1;
+      }
+    } else if (bodyTotal > 0 &&
+               bodyTotal <= BOOKFILER_HTTP_CLIENT_MAX_RESPONSE_SIZE) {
+      // the decoded body is at least this large
+      responseBeast->body().reserve(bodyTotal);
+    }
+  }
+  if (len == 0) {
+    return 0;
+  }
+  bodyEncodedReceived += len;
+  if (decoder.isActive()) {
+    if (decoder.write(data, len, [this](const char *data, std::size_t len) {
+          return writeBody(data, len);
+        }) < 0) {
+      bodyAbortFlag = true;
+      return -1;
+    }
+  } else if (writeBody(data, len) < 0) {
+    return -1;
+  }
+  if (progressCallback) {
+    progressCallback(bodyEncodedReceived, bodyTotal);
+  }
+  return 0;
+}
+
+int ClientImpl::writeBody(const char *data, std::size_t len) {
+  bodyReceived += len;
+  std::uint64_t maxSize = maxResponseSize;
+  if (maxSize == 0 && !isStreaming()) {
+    maxSize = BOOKFILER_HTTP_CLIENT_MAX_RESPONSE_SIZE;
+  }
+  if (maxSize > 0 && bodyReceived > maxSize) {
+    logStatus("::ClientImpl::writeBody",
+              "ERROR: response body larger than " + std::to_string(maxSize) +
+                  " bytes");
+    bodyAbortFlag = true;
+    return -1;
+  }
+  if (responseCallback) {
+    if (responseCallback(std::string_view(data, len)) < 0) {
+      bodyAbortFlag = true;
+      return -1;
+    }
+  } else if (responseFileBeast.is_open()) {
+    boost::system::error_code ec;
+    responseFileBeast.write(data, len, ec);
+    if (ec) {
+      logStatus("::ClientImpl::writeBody", "write " + responseFile, ec);
+      bodyAbortFlag = true;
+      return -1;
+    }
+  } else {
+    responseBeast->body().append(data, len);
+  }
+  return 0;
+}
+
+int ClientImpl::finishBody() {
+  if (responseFileBeast.is_open()) {
+    boost::system::error_code ec;
+    responseFileBeast.close(ec);
+  }
+  if (!decoder.isActive()) {
+    return 0;
+  }
+  clientState->decodedResponseNum++;
+  clientState->decodedEncodedBytes += bodyEncodedReceived;
+  clientState->decodedBytes += bodyReceived;
+  const bool doneFlag = decoder.isDone();
+  decoder.finish();
+  return doneFlag ? 0 : -1;
+}
+
+std::uint64_t ClientImpl::getResponseSize() { return bodyReceived; }
+
+std::uint64_t ClientImpl::getResponseEncodedSize() {
+  return bodyEncodedReceived;
+}
+
+int ClientImpl::parseResponse() {
+  cacheFinish();
+  responseFlag = true;
 
 #if BOOKFILER_HTTP_CLIENT_END_DEBUG_RESPONSE
-  std::cout << "\n=== THREAD " << threadId << " ===\n"
+  std::cout << "\n=== THREAD " << std::this_thread::get_id() << " ===\n"
             << moduleCode << "::ClientImpl::end response:\n"
             << *responseBeast << std::endl;
 #endif
+  return 0;
+}
+
+int ClientImpl::end() {
+  settingsPtr = clientState->getSettings();
+  if (timeoutOpt.value_or(settingsPtr->timeout).count() > 0 ||
+      retryMaxOpt.value_or(settingsPtr->retryMax) > 0 || hedgeFlag ||
+      coalesceOpt.value_or(settingsPtr->coalesceFlag)) {
+    // deadlines, retries, hedging and coalescing are run by the async client
+    if (!clientState->canWaitOnIo()) {
+      logStatus("::ClientImpl::end",
+                "ERROR: can not wait on the client threads from this thread");
+      return -1;
+    }
+    if (endAsync() < 0) {
+      return -1;
+    }
+    return wait();
+  }
+  http2RefusedNum = 0;
+  int rc = endSync();
+  // the request no longer counts as outstanding on its group endpoint
+  upstreamLeasePtr.reset();
+  return rc;
+}
 
+int ClientImpl::endSync() {
+  int rc = 0;
+  if (prepareRequest() < 0) {
+    return -1;
+  }
+  if (cacheBegin() > 0) {
+    return 0;
+  }
+  auto http2Ptr = clientState->getHttp2Connection(poolKey);
+  if (http2Ptr) {
+    return endHttp2(http2Ptr);
+  }
+
+  /* A pooled connection may have been closed by the server after the health
+   * check. Idempotent requests on a reused connection get one more try on a
+   * new connection.
+   */
   boost::system::error_code ec;
-  streamPtr->shutdown(ec);
-  streamPtr->next_layer().close(ec);
+  for (int attemptNum = 0; attemptNum < 2; attemptNum++) {
+    std::shared_ptr<ClientConnection> connectionPtr;
+    rc = clientState->poolPtr->acquire(poolKey, connectionPtr);
+    if (rc < 0) {
+      return -1;
+    }
+    const bool reused = connectionPtr != nullptr;
+    if (!reused) {
+      // an h2 connection may have come up while this request waited
+      http2Ptr = clientState->getHttp2Connection(poolKey);
+      if (http2Ptr) {
+        clientState->poolPtr->release(poolKey, nullptr, false);
+        return endHttp2(http2Ptr);
+      }
+      connectionPtr = std::make_shared<ClientConnection>();
+      rc = connect(*connectionPtr, requestHost, requestPort);
+      if (rc < 0) {
+        addPoolSample(true);
+        clientState->poolPtr->release(poolKey, connectionPtr, false);
+        return -1;
+      }
+      if (connectionPtr->http2Flag) {
+        // the HTTP/2 connection takes over the socket and frees the slot
+        http2Ptr = clientState->newHttp2Connection(poolKey, connectionPtr);
+        clientState->poolPtr->release(poolKey, nullptr, false);
+        if (!http2Ptr) {
+          return -1;
+        }
+        return endHttp2(http2Ptr);
+      }
+    }
+
+    newResponse();
+    poolSampleTime = std::chrono::steady_clock::now();
+    writeRequest(*connectionPtr->streamPtr, ec);
+    if (!ec) {
+      beast::flat_buffer buffer;
+      readResponse(*connectionPtr->streamPtr, buffer, ec);
+    }
+    if (ec) {
+      if (reused && isRetryable()) {
+        clientState->poolPtr->release(poolKey, connectionPtr, false);
+        logStatus("::ClientImpl::end", "stale pooled connection, retrying",
+                  ec);
+        continue;
+      }
+      addPoolSample(true);
+      clientState->poolPtr->release(poolKey, connectionPtr, false);
+      logStatus("::ClientImpl::end", "http::write/http::read", ec);
+      return -1;
+    }
+    addPoolSample(false);
+    clientState->poolPtr->release(poolKey, connectionPtr,
+                                  responseBeast->keep_alive());
+    break;
+  }
+  if (ec) {
+    return -1;
+  }
+  return parseResponse();
+}
+
+int ClientImpl::endHttp2(std::shared_ptr<ClientHttp2Connection> http2Ptr) {
+  if (!clientState->canWaitOnIo()) {
+    // the stream is only served by the client threads
+    logStatus("::ClientImpl::endHttp2",
+              "ERROR: can not wait on the client threads from this thread");
+    return -1;
+  }
+  newResponse();
+  std::promise<int> streamPromise;
+  std::future<int> streamFuture = streamPromise.get_future();
+  http2BodySourceType uploadSource;
+  if (isUploading()) {
+    uploadSource = [this](char *data, std::size_t len) {
+      return readUpload(data, len);
+    };
+  }
+  http2Ptr->submit(
+      requestBeast, responseBeast, uploadSource,
+      [this](const char *data, std::size_t len) {
+        return deliverBody(data, len);
+      },
+      [&streamPromise](int rc) { streamPromise.set_value(rc); });
+  int rc = streamFuture.get();
+  if (rc == 1 && http2RefusedNum < 3) {
+    // not processed, the request goes over another connection
+    http2RefusedNum++;
+    logStatus("::ClientImpl::endHttp2",
+              "connection going away, sending the request again");
+    return endSync();
+  }
+  if (rc > 0) {
+    rc = -1;
+  }
+  if (finishBody() < 0 && rc == 0) {
+    logStatus("::ClientImpl::endHttp2", "ERROR: truncated encoded body");
+    rc = -1;
+  }
+  if (rc < 0) {
+    return -1;
+  }
+  return parseResponse();
+}
+
+int ClientImpl::endAsync() { return endAsync(nullptr); }
+
+int ClientImpl::endAsync(clientCallbackType callback) {
+  {
+    const std::lock_guard<std::mutex> lock(asyncMutex);
+    if (asyncFlag) {
+      logStatus("::ClientImpl::endAsync",
+                "ERROR: the previous request has not finished");
+      return -1;
+    }
+    asyncFlag = true;
+    asyncRc = 0;
+    asyncCallback = std::move(callback);
+  }
+  settingsPtr = clientState->getSettings();
+  if (prepareRequest() < 0) {
+    upstreamLeasePtr.reset();
+    const std::lock_guard<std::mutex> lock(asyncMutex);
+    asyncFlag = false;
+    asyncCallback = nullptr;
+    return -1;
+  }
+  if (!asyncStrandPtr) {
+    asyncStrandPtr =
+        std::make_unique<asio::strand<asio::io_context::executor_type>>(
+            clientState->ioContext.get_executor());
+  }
+  auto self = shared_from_this();
+  if (cacheBegin() > 0) {
+    asio::post(*asyncStrandPtr, [self]() { self->asyncFinish(0); });
+    return 0;
+  }
+  if (coalesceBegin() > 0) {
+    const uint64_t generation = ++asyncGeneration;
+    asio::post(*asyncStrandPtr,
+               [self, generation]() { self->coalesceWait(generation); });
+    return 0;
+  }
+  clientState->retryBudgetPtr->deposit();
+  const uint64_t generation = ++asyncGeneration;
+  asio::post(*asyncStrandPtr,
+             [self, generation]() { self->asyncBegin(generation); });
+  return 0;
+}
+
+void ClientImpl::asyncBegin(uint64_t generation) {
+  auto self = shared_from_this();
+  asyncAttemptNum = asyncRetryNum = asyncPrimaryRc = http2RefusedNum = 0;
+  asyncCancelFlag = asyncHedgeWonFlag = hedgeRunFlag = false;
+  asyncPrimaryFlag = true;
+  hedgePtr.reset();
+  asyncRetryMax = retryMaxOpt.value_or(settingsPtr->retryMax);
+  const std::chrono::milliseconds timeout =
+      timeoutOpt.value_or(settingsPtr->timeout);
+  asyncDeadline = {};
+  if (timeout.count() > 0) {
+    asyncDeadline = std::chrono::steady_clock::now() + timeout;
+    if (!deadlineTimerPtr) {
+      deadlineTimerPtr =
+          std::make_unique<asio::steady_timer>(clientState->ioContext);
+    }
+    deadlineTimerPtr->expires_at(asyncDeadline);
+    deadlineTimerPtr->async_wait(asio::bind_executor(
+        *asyncStrandPtr, [self, generation](boost::system::error_code ec) {
+          if (ec || generation != self->asyncGeneration ||
+              (!self->asyncPrimaryFlag && !self->hedgeRunFlag)) {
+            return;
+          }
+          self->clientState->timeoutNum++;
+          logStatus("::ClientImpl::endAsync",
+                    "ERROR: deadline exceeded for " + self->poolKey);
+          self->asyncCancelAttempt();
+          if (self->hedgePtr && self->hedgeRunFlag) {
+            self->hedgePtr->cancel();
+          }
+        }));
+  }
+  // a hedge is only sent once enough latencies of the host are known
+  if (hedgeFlag && settingsPtr->hedgePercentile > 0 && isIdempotent() &&
+      !isStreaming() && !isUploading()) {
+    auto hedgeDelayOpt =
+        clientState->latencyPtr->percentile(poolKey,
+                                            settingsPtr->hedgePercentile);
+    if (hedgeDelayOpt) {
+      if (!hedgeTimerPtr) {
+        hedgeTimerPtr =
+            std::make_unique<asio::steady_timer>(clientState->ioContext);
+      }
+      hedgeTimerPtr->expires_after(*hedgeDelayOpt);
+      hedgeTimerPtr->async_wait(asio::bind_executor(
+          *asyncStrandPtr, [self, generation](boost::system::error_code ec) {
+            if (!ec) {
+              self->asyncHedge(generation);
+            }
+          }));
+    }
+  }
+  asyncStart();
+}
+
+void ClientImpl::asyncStart() {
+  asyncAttemptTime = std::chrono::steady_clock::now();
+  if (asyncCancelFlag) {
+    asyncAttemptDone(-1, false);
+    return;
+  }
+  auto http2Ptr = clientState->getHttp2Connection(poolKey);
+  if (http2Ptr) {
+    asyncHttp2(http2Ptr);
+    return;
+  }
+  asyncAcquire();
+}
+
+void ClientImpl::asyncAcquire() {
+  auto self = shared_from_this();
+  std::chrono::milliseconds acquireTimeout =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          clientState->poolPtr->getSettings().acquireTimeout);
+  if (asyncDeadline != std::chrono::steady_clock::time_point{}) {
+    // the waiter fails at the deadline
+    acquireTimeout = std::min(
+        acquireTimeout,
+        std::max(std::chrono::milliseconds(1),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     asyncDeadline - std::chrono::steady_clock::now())));
+  }
+  asyncWaiterPtr = clientState->poolPtr->asyncAcquire(
+      poolKey, acquireTimeout,
+      [self](int rc, std::shared_ptr<ClientConnection> connectionPtr) {
+        asio::post(*self->asyncStrandPtr, [self, rc, connectionPtr]() {
+          self->asyncWaiterPtr.reset();
+          if (rc < 0) {
+            self->asyncAttemptDone(-1, false);
+            return;
+          }
+          if (self->asyncCancelFlag) {
+            // the slot was not used, an idle connection stays reusable
+            self->clientState->poolPtr->release(self->poolKey, connectionPtr,
+                                                true);
+            self->asyncAttemptDone(-1, false);
+            return;
+          }
+          self->asyncReusedFlag = connectionPtr != nullptr;
+          if (!connectionPtr) {
+            // an h2 connection may have come up while this request waited
+            auto http2Ptr =
+                self->clientState->getHttp2Connection(self->poolKey);
+            if (http2Ptr) {
+              self->clientState->poolPtr->release(self->poolKey, nullptr,
+                                                  false);
+              self->asyncHttp2(http2Ptr);
+              return;
+            }
+          }
+          if (connectionPtr) {
+            self->asyncConnectionPtr = connectionPtr;
+            self->asyncWrite();
+          } else {
+            self->asyncConnectionPtr = std::make_shared<ClientConnection>();
+            self->asyncConnect();
+          }
+        });
+      });
+}
+
+void ClientImpl::asyncConnect() {
+  auto self = shared_from_this();
+  if (transport == clientTransport::tls) {
+    asyncConnectionPtr->sslContextPtr = clientState->getSslContext();
+  }
+  asyncConnectionPtr->streamPtr = std::make_unique<ClientStream>(
+      transport, clientState->ioContext,
+      asyncConnectionPtr->sslContextPtr.get());
+  if (transport == clientTransport::local) {
+    asyncConnectionPtr->streamPtr->unixSocket()->async_connect(
+        asio::local::stream_protocol::endpoint(unixSocketPath),
+        asio::bind_executor(*asyncStrandPtr,
+                            [self](boost::system::error_code ec) {
+                              if (ec) {
+                                self->asyncError(
+                                    "connect " + self->unixSocketPath, ec);
+                                return;
+                              }
+                              self->asyncWrite();
+                            }));
+    return;
+  }
+  clientState->resolverPtr->asyncResolve(
+      requestHost, requestPort,
+      [self](boost::system::error_code ec,
+             tcp::resolver::results_type results) {
+        asio::post(*self->asyncStrandPtr, [self, ec, results]() {
+          if (ec || self->asyncCancelFlag) {
+            self->asyncError("resolve " + self->requestHost,
+                             ec ? ec : asio::error::operation_aborted);
+            return;
+          }
+          self->asyncConnectorPtr = std::make_shared<ClientConnector>(
+              self->clientState->ioContext,
+              self->settingsPtr->connectStagger);
+          self->asyncConnectorPtr->start(
+              results,
+              [self](boost::system::error_code ec, tcp::socket socket) {
+                auto socketPtr =
+                    std::make_shared<tcp::socket>(std::move(socket));
+                asio::post(*self->asyncStrandPtr, [self, ec, socketPtr]() {
+                  std::shared_ptr<ClientConnector> connectorPtr;
+                  connectorPtr.swap(self->asyncConnectorPtr);
+                  if (ec || self->asyncCancelFlag) {
+                    self->asyncError("connect " + self->requestHost,
+                                     ec ? ec : asio::error::operation_aborted);
+                    return;
+                  }
+                  self->countConnect(*connectorPtr);
+                  *self->asyncConnectionPtr->streamPtr->tcpSocket() =
+                      std::move(*socketPtr);
+                  if (self->transport == clientTransport::tcp) {
+                    self->asyncWrite();
+                    return;
+                  }
+                  self->asyncHandshake();
+                });
+              });
+        });
+      });
+}
+
+void ClientImpl::asyncHandshake() {
+  auto self = shared_from_this();
+  prepareStream(*asyncConnectionPtr);
+  asyncConnectionPtr->streamPtr->tls()->async_handshake(
+      ssl::stream_base::handshake_type::client,
+      asio::bind_executor(
+          *asyncStrandPtr, [self](boost::system::error_code ec) {
+            if (ec) {
+              self->asyncError("handshake", ec);
+              return;
+            }
+            self->finishHandshake(*self->asyncConnectionPtr);
+            if (self->asyncConnectionPtr->http2Flag) {
+              // the HTTP/2 connection takes over the socket and frees the slot
+              auto http2Ptr = self->clientState->newHttp2Connection(
+                  self->poolKey, self->asyncConnectionPtr);
+              self->asyncConnectionPtr.reset();
+              self->clientState->poolPtr->release(self->poolKey, nullptr,
+                                                  false);
+              if (!http2Ptr) {
+                self->asyncAttemptDone(-1, false);
+                return;
+              }
+              self->asyncHttp2(http2Ptr);
+              return;
+            }
+            self->asyncWrite();
+          }));
+}
+
+void ClientImpl::asyncHttp2(
+    std::shared_ptr<ClientHttp2Connection> http2Ptr) {
+  auto self = shared_from_this();
+  newResponse();
+  http2BodySourceType uploadSource;
+  if (isUploading()) {
+    uploadSource = [self](char *data, std::size_t len) {
+      return self->readUpload(data, len);
+    };
+  }
+  asyncHttp2Ptr = http2Ptr;
+  asyncStreamPtr = http2Ptr->submit(
+      requestBeast, responseBeast, uploadSource,
+      [self](const char *data, std::size_t len) {
+        return self->deliverBody(data, len);
+      },
+      [self](int rc) {
+        asio::post(*self->asyncStrandPtr, [self, rc]() {
+          self->asyncStreamPtr.reset();
+          self->asyncHttp2Ptr.reset();
+          if (rc == 1 && !self->asyncCancelFlag &&
+              self->http2RefusedNum < 3) {
+            // not processed, open another connection
+            self->http2RefusedNum++;
+            self->asyncStart();
+            return;
+          }
+          int streamRc = rc > 0 ? -1 : rc;
+          if (self->finishBody() < 0 && streamRc == 0) {
+            logStatus("::ClientImpl::asyncHttp2",
+                      "ERROR: truncated encoded body");
+            streamRc = -1;
+          }
+          if (streamRc < 0) {
+            self->asyncAttemptDone(
+                -1, !self->asyncCancelFlag && self->isRetryable());
+            return;
+          }
+          self->parseResponse();
+          self->asyncAttemptDone(0, self->isRetryStatus());
+        });
+      });
+}
+
+void ClientImpl::asyncWrite() {
+  auto self = shared_from_this();
+  newResponse();
+  poolSampleTime = std::chrono::steady_clock::now();
+  asyncBuffer.consume(asyncBuffer.size());
+  if (isUploading()) {
+    serializerPtr =
+        std::make_shared<http::request_serializer<http::string_body>>(
+            *requestBeast);
+    uploadBuffer.resize(65536);
+    http::async_write_header(
+        *asyncConnectionPtr->streamPtr, *serializerPtr,
+        asio::bind_executor(*asyncStrandPtr, [self](
+                                                 boost::system::error_code ec,
+                                                 std::size_t) {
+          if (ec) {
+            self->asyncError("http::async_write_header", ec);
+            return;
+          }
+          self->asyncUpload();
+        }));
+    return;
+  }
+  http::async_write(
+      *asyncConnectionPtr->streamPtr, *requestBeast,
+      asio::bind_executor(*asyncStrandPtr,
+                          [self](boost::system::error_code ec, std::size_t) {
+                            if (ec) {
+                              self->asyncError("http::async_write", ec);
+                              return;
+                            }
+                            self->asyncRead();
+                          }));
+}
+
+void ClientImpl::asyncUpload() {
+  auto self = shared_from_this();
+  std::int64_t len = readUpload(uploadBuffer.data(), uploadBuffer.size());
+  if (len < 0) {
+    asyncError("request body", asio::error::operation_aborted);
+    return;
+  }
+  auto handler = asio::bind_executor(
+      *asyncStrandPtr,
+      [self, len](boost::system::error_code ec, std::size_t) {
+        if (ec) {
+          self->asyncError("asio::async_write", ec);
+        } else if (len == 0) {
+          self->asyncRead();
+        } else {
+          self->asyncUpload();
+        }
+      });
+  if (requestBeast->chunked()) {
+    if (len == 0) {
+      asio::async_write(*asyncConnectionPtr->streamPtr,
+                        http::make_chunk_last(), handler);
+    } else {
+      asio::async_write(
+          *asyncConnectionPtr->streamPtr,
+          http::make_chunk(asio::buffer(uploadBuffer.data(), len)), handler);
+    }
+  } else if (len == 0) {
+    asyncRead();
+  } else {
+    asio::async_write(*asyncConnectionPtr->streamPtr,
+                      asio::buffer(uploadBuffer.data(), len), handler);
+  }
+}
+
+void ClientImpl::asyncRead() {
+  auto self = shared_from_this();
+  serializerPtr.reset();
+  http::async_read_header(
+      *asyncConnectionPtr->streamPtr, asyncBuffer, *parserPtr,
+      asio::bind_executor(
+          *asyncStrandPtr, [self](boost::system::error_code ec, std::size_t) {
+            if (ec) {
+              self->asyncError("http::async_read_header", ec);
+              return;
+            }
+            self->responseBeast->base() = self->parserPtr->get().base();
+            self->asyncReadBody();
+          }));
+}
 
+void ClientImpl::asyncReadBody() {
+  if (parserPtr->is_done()) {
+    const int rc = finishBody();
+    addPoolSample(rc < 0);
+    clientState->poolPtr->release(poolKey, std::move(asyncConnectionPtr),
+                                  responseBeast->keep_alive());
+    if (rc < 0) {
+      logStatus("::ClientImpl::asyncReadBody",
+                "ERROR: truncated encoded body");
+      asyncAttemptDone(-1, false);
+      return;
+    }
+    parseResponse();
+    asyncAttemptDone(0, isRetryStatus());
+    return;
+  }
+  auto self = shared_from_this();
+  parserPtr->get().body().data = bodyBuffer.data();
+  parserPtr->get().body().size = bodyBuffer.size();
+  http::async_read(
+      *asyncConnectionPtr->streamPtr, asyncBuffer, *parserPtr,
+      asio::bind_executor(
+          *asyncStrandPtr, [self](boost::system::error_code ec, std::size_t) {
+            if (ec == http::error::need_buffer) {
+              ec = {};
+            }
+            if (ec) {
+              self->asyncError("http::async_read", ec);
+              return;
+            }
+            if (self->deliverBody(self->bodyBuffer.data(),
+                                  self->bodyBuffer.size() -
+                                      self->parserPtr->get().body().size) <
+                0) {
+              self->asyncError("response body",
+                               asio::error::operation_aborted);
+              return;
+            }
+            self->asyncReadBody();
+          }));
+}
+
+void ClientImpl::asyncError(std::string what, boost::system::error_code ec) {
+  finishBody();
+  // same retry rule as end(), a stale connection is not a failed attempt
+  const bool staleFlag =
+      asyncReusedFlag && asyncAttemptNum == 0 && isRetryable();
+  if (!asyncCancelFlag && !staleFlag) {
+    addPoolSample(true);
+  }
+  clientState->poolPtr->release(poolKey, std::move(asyncConnectionPtr),
+                                false);
+  if (asyncCancelFlag) {
+    asyncAttemptDone(-1, false);
+    return;
+  }
+  if (staleFlag) {
+    logStatus("::ClientImpl::endAsync", "stale pooled connection, retrying",
+              ec);
+    asyncAttemptNum++;
+    asyncStart();
+    return;
+  }
+  logStatus("::ClientImpl::endAsync", what, ec);
+  asyncAttemptDone(-1, isRetryable());
+}
+
+void ClientImpl::asyncAttemptDone(int rc, bool retryFlag) {
+  auto now = std::chrono::steady_clock::now();
+  if (rc == 0 && !retryFlag && !asyncCancelFlag) {
+    clientState->latencyPtr->add(
+        poolKey, std::chrono::duration_cast<std::chrono::milliseconds>(
+                     now - asyncAttemptTime));
+  }
+  if (retryFlag && !asyncCancelFlag && asyncRetryNum < asyncRetryMax &&
+      isIdempotent()) {
+    // full jitter on an exponential backoff
+    std::chrono::milliseconds backoff = std::min(
+        settingsPtr->retryBackoffMax,
+        settingsPtr->retryBackoff * (1 << std::min(asyncRetryNum, 16)));
+    thread_local std::mt19937 randomEngine{std::random_device{}()};
+    std::uniform_int_distribution<long long> distribution(0, backoff.count());
+    backoff = std::chrono::milliseconds(distribution(randomEngine));
+    const bool deadlineFlag =
+        asyncDeadline != std::chrono::steady_clock::time_point{} &&
+        now + backoff >= asyncDeadline;
+    if (!deadlineFlag) {
+      if (clientState->retryBudgetPtr->withdraw()) {
+        asyncRetryNum++;
+        clientState->retryNum++;
+        if (!retryTimerPtr) {
+          retryTimerPtr =
+              std::make_unique<asio::steady_timer>(clientState->ioContext);
+        }
+        auto self = shared_from_this();
+        retryTimerPtr->expires_after(backoff);
+        retryTimerPtr->async_wait(asio::bind_executor(
+            *asyncStrandPtr, [self](boost::system::error_code ec) {
+              if (ec || self->asyncCancelFlag) {
+                self->asyncPrimaryDone(-1);
+                return;
+              }
+              self->asyncStart();
+            }));
+        return;
+      }
+      logStatus("::ClientImpl::endAsync",
+                "retry budget exhausted for " + poolKey);
+    }
+  }
+  asyncPrimaryDone(rc);
+}
+
+void ClientImpl::asyncPrimaryDone(int rc) {
+  asyncPrimaryFlag = false;
+  asyncPrimaryRc = rc;
+  if (asyncHedgeWonFlag) {
+    // this attempt was cancelled once the hedged request succeeded
+    adoptResponse(*hedgePtr);
+    hedgePtr.reset();
+    asyncFinish(0);
+    return;
+  }
+  if (hedgePtr && hedgeRunFlag) {
+    if (rc < 0) {
+      // the hedged request may still succeed
+      return;
+    }
+    hedgePtr->cancel();
+  }
+  hedgePtr.reset();
+  hedgeRunFlag = false;
+  asyncFinish(rc);
+}
+
+void ClientImpl::asyncCancelAttempt() {
+  asyncCancelFlag = true;
+  if (retryTimerPtr) {
+    retryTimerPtr->cancel();
+  }
+  if (asyncWaiterPtr) {
+    clientState->poolPtr->cancelAcquire(asyncWaiterPtr);
+  }
+  if (asyncConnectorPtr) {
+    asyncConnectorPtr->cancel();
+  }
+  if (asyncConnectionPtr && asyncConnectionPtr->streamPtr) {
+    // pending operations complete with operation_aborted
+    asyncConnectionPtr->streamPtr->close();
+  }
+  if (asyncHttp2Ptr && asyncStreamPtr) {
+    asyncHttp2Ptr->cancel(asyncStreamPtr);
+  }
+}
+
+void ClientImpl::asyncHedge(uint64_t generation) {
+  if (generation != asyncGeneration || !asyncPrimaryFlag || asyncCancelFlag ||
+      hedgePtr) {
+    return;
+  }
+  // hedges take from the retry budget too
+  if (!clientState->retryBudgetPtr->withdraw()) {
+    return;
+  }
+  auto hedge = std::make_shared<ClientImpl>();
+  hedge->urlPtr = urlPtr;
+  hedge->method = method;
+  hedge->settingsDoc = settingsDoc;
+  hedge->clientState = clientState;
+  hedge->unixSocketPath = unixSocketPath;
+  // the hedge may go to another endpoint of the group
+  hedge->upstreamGroupName = upstreamGroupName;
+  *hedge->requestBeast = *requestBeast;
+  hedge->maxResponseSize = maxResponseSize;
+  hedge->cacheValidatorFlag = cacheValidatorFlag;
+  // would wait for this request instead of racing it
+  hedge->coalesceOpt = false;
+  hedge->timeoutOpt = std::chrono::milliseconds(0);
+  hedge->retryMaxOpt = 0;
+  hedgePtr = hedge;
+  hedgeRunFlag = true;
+  clientState->hedgeNum++;
+  auto self = shared_from_this();
+  int rc = hedge->endAsync([self, hedge](int rc) {
+    asio::post(*self->asyncStrandPtr,
+               [self, hedge, rc]() { self->asyncHedgeDone(hedge, rc); });
+  });
+  if (rc < 0) {
+    hedgePtr.reset();
+    hedgeRunFlag = false;
+  }
+}
+
+void ClientImpl::asyncHedgeDone(std::shared_ptr<ClientImpl> hedge, int rc) {
+  if (hedge != hedgePtr) {
+    // the request finished before this hedge
+    return;
+  }
+  hedgeRunFlag = false;
+  if (!asyncPrimaryFlag) {
+    // the own attempts failed and waited for the hedge
+    if (rc == 0) {
+      clientState->hedgeWinNum++;
+      adoptResponse(*hedge);
+    }
+    hedgePtr.reset();
+    asyncFinish(rc == 0 ? 0 : asyncPrimaryRc);
+    return;
+  }
+  if (rc == 0) {
+    clientState->hedgeWinNum++;
+    asyncHedgeWonFlag = true;
+    asyncCancelAttempt();
+    return;
+  }
+  // a failed hedge leaves the own attempt running
+  hedgePtr.reset();
+}
+
+void ClientImpl::adoptResponse(ClientImpl &hedge) {
+  responseBeast = hedge.responseBeast;
+  responsePtr = hedge.responsePtr;
+  responseJsonDoc = hedge.responseJsonDoc;
+  responseFlag = hedge.responseFlag;
+  responseJsonFlag = hedge.responseJsonFlag;
+  bodyReceived = hedge.bodyReceived;
+  bodyEncodedReceived = hedge.bodyEncodedReceived;
+}
+
+void ClientImpl::asyncFinish(int rc) {
+  if (coalesceLeaderFlag) {
+    coalesceLeaderFlag = false;
+    clientState->singleFlightPtr->finish(coalesceKey, rc,
+                                         rc == 0 ? responseBeast : nullptr);
+  }
+  if (deadlineTimerPtr) {
+    deadlineTimerPtr->cancel();
+  }
+  if (hedgeTimerPtr) {
+    hedgeTimerPtr->cancel();
+  }
+  upstreamLeasePtr.reset();
+  clientCallbackType callback;
+  {
+    const std::lock_guard<std::mutex> lock(asyncMutex);
+    callback.swap(asyncCallback);
+    asyncRc = rc;
+    // the callback may chain the next request, waiters stay blocked
+    asyncFlag = false;
+    if (callback) {
+      asyncCallbackNum++;
+      asyncCallbackThread = std::this_thread::get_id();
+    }
+  }
+  if (callback) {
+    callback(rc);
+    const std::lock_guard<std::mutex> lock(asyncMutex);
+    asyncCallbackNum--;
+  }
+  asyncCondition.notify_all();
+}
+
+int ClientImpl::cacheBegin() {
+  auto &cache = *clientState->cachePtr;
+  if (cacheValidatorFlag) {
+    // validators of the previous request on this client
+    requestBeast->erase(http::field::if_none_match);
+    requestBeast->erase(http::field::if_modified_since);
+    cacheValidatorFlag = false;
+  }
+  cacheKey = std::string(requestBeast->method_string()) + " " + poolKey +
+             std::string(requestBeast->target());
+  cacheEntryPtr.reset();
+  cacheStoreFlag = false;
+  if (!cache.isEnabled() || requestBeast->method() != http::verb::get ||
+      isStreaming() || isUploading() ||
+      requestBeast->find(http::field::if_none_match) != requestBeast->end() ||
+      requestBeast->find(http::field::if_modified_since) !=
+          requestBeast->end()) {
+    return 0;
+  }
+  auto directiveMap = ClientCache::parseCacheControl(
+      std::string((*requestBeast)[http::field::cache_control]));
+  if (directiveMap.count("no-store")) {
+    return 0;
+  }
+  cacheStoreFlag = true;
+  clientCacheState state;
+  auto entryPtr = cache.lookup(cacheKey, *requestBeast, state);
+  if (!entryPtr) {
+    return 0;
+  }
+  const bool reloadFlag =
+      directiveMap.count("no-cache") || directiveMap["max-age"] == "0" ||
+      (*requestBeast)[http::field::pragma] == "no-cache";
+  if (!reloadFlag && !cacheRevalidateFlag &&
+      state != clientCacheState::stale) {
+    if (state == clientCacheState::staleWhileRevalidate &&
+        cache.beginRevalidate(entryPtr)) {
+      cacheRevalidate(entryPtr);
+    }
+    newResponse();
+    responseBeast = entryPtr->responseBeast;
+    responsePtr->setResponse(responseBeast);
+    bodyReceived = responseBeast->body().size();
+    cacheStoreFlag = false;
+    parseResponse();
+    return 1;
+  }
+  if (entryPtr->etag.empty() && entryPtr->lastModified.empty()) {
+    return 0;
+  }
+  if (!entryPtr->etag.empty()) {
+    requestBeast->set(http::field::if_none_match, entryPtr->etag);
+  }
+  if (!entryPtr->lastModified.empty()) {
+    requestBeast->set(http::field::if_modified_since, entryPtr->lastModified);
+  }
+  cacheValidatorFlag = true;
+  cacheEntryPtr = entryPtr;
+  return 0;
+}
+
+int ClientImpl::cacheFinish() {
+  auto &cache = *clientState->cachePtr;
+  if (!cache.isEnabled() || isStreaming()) {
+    return 0;
+  }
+  const unsigned status = responseBeast->result_int();
+  switch (requestBeast->method()) {
+  case http::verb::get:
+  case http::verb::head:
+  case http::verb::options:
+  case http::verb::trace:
+    break;
+  default:
+    // RFC 7234 4.4, the stored GET response may be outdated now
+    if (status < 400) {
+      cache.invalidate("GET " + poolKey + std::string(requestBeast->target()));
+    }
+    return 0;
+  }
+  if (cacheEntryPtr && responseBeast->result() == http::status::not_modified) {
+    cache.update(cacheEntryPtr, *responseBeast);
+    responseBeast = cacheEntryPtr->responseBeast;
+    responsePtr->setResponse(responseBeast);
+    bodyReceived = responseBeast->body().size();
+    return 0;
+  }
+  if (cacheStoreFlag && !bodyAbortFlag) {
+    cache.store(cacheKey, *requestBeast, responseBeast);
+  }
+  return 0;
+}
+
+void ClientImpl::cacheRevalidate(std::shared_ptr<ClientCacheEntry> entryPtr) {
+  auto revalidatePtr = std::make_shared<ClientImpl>();
+  revalidatePtr->urlPtr = urlPtr;
+  revalidatePtr->method = method;
+  revalidatePtr->settingsDoc = settingsDoc;
+  revalidatePtr->clientState = clientState;
+  revalidatePtr->unixSocketPath = unixSocketPath;
+  revalidatePtr->upstreamGroupName = upstreamGroupName;
+  *revalidatePtr->requestBeast = *requestBeast;
+  revalidatePtr->maxResponseSize = maxResponseSize;
+  revalidatePtr->cacheRevalidateFlag = true;
+  auto cachePtr = clientState->cachePtr;
+  int rc = revalidatePtr->endAsync(
+      [cachePtr, entryPtr](int) { cachePtr->endRevalidate(entryPtr); });
+  if (rc < 0) {
+    cachePtr->endRevalidate(entryPtr);
+  }
+}
+
+int ClientImpl::coalesceBegin() {
+  coalesceLeaderFlag = false;
+  if (!coalesceOpt.value_or(settingsPtr->coalesceFlag) || isStreaming() ||
+      isUploading()) {
+    return 0;
+  }
+  switch (requestBeast->method()) {
+  case http::verb::get:
+  case http::verb::head:
+  case http::verb::options:
+    break;
+  default:
+    return 0;
+  }
+  coalesceKey = std::string(requestBeast->method_string()) + " " + poolKey +
+                std::string(requestBeast->target());
+  for (auto &name : settingsPtr->coalesceHeaderList) {
+    auto it = requestBeast->find(name);
+    if (it != requestBeast->end()) {
+      coalesceKey += "\n" + name + ": " + std::string(it->value());
+    }
+  }
+  auto self = shared_from_this();
+  if (clientState->singleFlightPtr->join(
+          coalesceKey, this,
+          [self](int rc,
+                 std::shared_ptr<http::response<http::string_body>>
+                     responseBeast_) {
+            asio::post(*self->asyncStrandPtr, [self, rc, responseBeast_]() {
+              self->coalesceDone(rc, responseBeast_);
+            });
+          })) {
+    coalesceLeaderFlag = true;
+    return 0;
+  }
+  return 1;
+}
+
+void ClientImpl::coalesceDone(
+    int rc, std::shared_ptr<http::response<http::string_body>> responseBeast_) {
+  if (rc == 0) {
+    newResponse();
+    responseBeast = responseBeast_;
+    responsePtr->setResponse(responseBeast);
+    bodyReceived = responseBeast->body().size();
+    // the leader already stored or merged the response
+    cacheStoreFlag = false;
+    cacheEntryPtr.reset();
+    parseResponse();
+  }
+  asyncFinish(rc);
+}
+
+void ClientImpl::coalesceWait(uint64_t generation) {
+  const std::chrono::milliseconds timeout =
+      timeoutOpt.value_or(settingsPtr->timeout);
+  if (timeout.count() == 0) {
+    return;
+  }
+  if (!deadlineTimerPtr) {
+    deadlineTimerPtr =
+        std::make_unique<asio::steady_timer>(clientState->ioContext);
+  }
+  auto self = shared_from_this();
+  deadlineTimerPtr->expires_after(timeout);
+  deadlineTimerPtr->async_wait(asio::bind_executor(
+      *asyncStrandPtr, [self, generation](boost::system::error_code ec) {
+        if (ec || generation != self->asyncGeneration ||
+            !self->coalesceLeave()) {
+          return;
+        }
+        self->clientState->timeoutNum++;
+        logStatus("::ClientImpl::endAsync",
+                  "ERROR: deadline exceeded for " + self->poolKey);
+        self->asyncFinish(-1);
+      }));
+}
+
+bool ClientImpl::coalesceLeave() {
+  return !coalesceLeaderFlag && !coalesceKey.empty() &&
+         clientState->singleFlightPtr->leave(coalesceKey, this);
+}
+
+int ClientImpl::cancel() {
+  if (!asyncStrandPtr) {
+    return -1;
+  }
+  auto self = shared_from_this();
+  asio::post(*asyncStrandPtr, [self]() {
+    if (self->coalesceLeave()) {
+      // waited on another client's request, which keeps running
+      self->asyncFinish(-1);
+      return;
+    }
+    if (!self->asyncPrimaryFlag && !self->hedgeRunFlag) {
+      return;
+    }
+    self->asyncCancelAttempt();
+    if (self->hedgePtr && self->hedgeRunFlag) {
+      self->hedgePtr->cancel();
+    }
+  });
   return 0;
 }
 
-int ClientImpl::endAsync() { return 0; }
-int ClientImpl::wait() { return 0; }
+int ClientImpl::wait() {
+  std::unique_lock<std::mutex> lock(asyncMutex);
+  // the callback itself may wait on its client
+  const bool callbackFlag = asyncCallbackNum > 0 &&
+                            asyncCallbackThread == std::this_thread::get_id();
+  asyncCondition.wait(lock, [this, callbackFlag] {
+    return !asyncFlag && (callbackFlag || asyncCallbackNum == 0);
+  });
+  return asyncRc;
+}
 
 } // namespace HTTP
 } // namespace bookfiler
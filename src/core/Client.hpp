@@ -12,14 +12,29 @@
 // config
 #include "config.hpp"
 
+// C++17
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
 /* boost 1.72.0
  * License: Boost Software License (similar to BSD and MIT)
  */
+#include <boost/asio/bind_executor.hpp>
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/ssl/stream.hpp>
+#include <boost/beast/core/file.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http/buffer_body.hpp>
 #include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/chunk_encode.hpp>
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <boost/beast/http/write.hpp>
@@ -27,6 +42,8 @@
 #include <boost/certify/https_verification.hpp>
 
 // Local Project
+#include "ClientDecoder.hpp"
+#include "ClientState.hpp"
 #include "Request.hpp"
 #include "Response.hpp"
 #include "Url.hpp"
@@ -43,32 +60,225 @@ using tcp = boost::asio::ip::tcp;
 namespace bookfiler {
 namespace HTTP {
 
-class ClientImpl : public Client {
+/* The response body, or a copy of it if the response is shared, parsed in
+ * situ. The document's strings point into the buffer, so both share one
+ * lifetime.
+ */
+class ClientResponseJson {
+public:
+  std::string buffer;
+  rapidjson::Document doc;
+};
+
+class ClientImpl : public Client,
+                   public std::enable_shared_from_this<ClientImpl> {
 private:
   std::shared_ptr<UrlImpl> urlPtr;
   std::shared_ptr<rapidjson::Value> settingsDoc;
+  // parsed on the first getResponseJson() call
   std::shared_ptr<rapidjson::Document> responseJsonDoc;
-  std::string method, CaInfoPath;
-  std::string_view responseStr;
+  std::string method;
+  // responseFlag is set once a response is complete
+  bool responseFlag, responseJsonFlag;
   std::shared_ptr<std::map<std::string, std::string>> headersMapPtr;
   std::shared_ptr<RequestImpl> requestPtr;
   std::shared_ptr<ResponseImpl> responsePtr;
   std::shared_ptr<boost::beast::http::request<boost::beast::http::string_body>> requestBeast;
   std::shared_ptr<boost::beast::http::response<boost::beast::http::string_body>>
       responseBeast;
-  bool skipPeerVerification, skipHostnameVerification;
+  std::shared_ptr<ClientState> clientState;
+  // settings snapshot taken by end and endAsync
+  std::shared_ptr<const ClientSettings> settingsPtr;
+  // socket path the request is sent over instead of TCP
+  std::string unixSocketPath;
+  // the group picks the endpoint of every request
+  std::string upstreamGroupName;
+  std::shared_ptr<ClientUpstreamLease> upstreamLeasePtr;
+  // set by prepareRequest
+  std::string requestHost, requestPort, poolKey;
+  clientTransport transport;
+  // endAsync state
+  std::mutex asyncMutex;
+  std::condition_variable asyncCondition;
+  bool asyncFlag, asyncReusedFlag;
+  int asyncRc, asyncAttemptNum;
+  // requests sent again after a connection refused them at GOAWAY
+  int http2RefusedNum;
+  // callbacks still running, wait() returns once they finished
+  int asyncCallbackNum;
+  std::thread::id asyncCallbackThread;
+  clientCallbackType asyncCallback;
+  std::shared_ptr<ClientConnection> asyncConnectionPtr;
+  beast::flat_buffer asyncBuffer;
+  // response body delivery
+  clientBodyCallbackType responseCallback;
+  clientProgressCallbackType progressCallback;
+  std::string responseFile;
+  beast::file responseFileBeast;
+  // bodyReceived counts decoded bytes, bodyEncodedReceived those received
+  std::uint64_t maxResponseSize, bodyReceived, bodyEncodedReceived, bodyTotal;
+  bool bodyBeginFlag, bodyAbortFlag;
+  std::shared_ptr<http::response_parser<http::buffer_body>> parserPtr;
+  std::vector<char> bodyBuffer;
+  ClientDecoder decoder;
+  // request body streamed from setBodyFile or setBodySource
+  clientBodySourceType bodySource;
+  std::string bodyFile;
+  beast::file bodyFileBeast;
+  std::uint64_t bodyFileRemaining;
+  std::vector<char> uploadBuffer;
+  std::shared_ptr<http::request_serializer<http::string_body>> serializerPtr;
+  // unset means the settings default
+  std::optional<std::chrono::milliseconds> timeoutOpt;
+  std::optional<int> retryMaxOpt;
+  bool hedgeFlag;
+  std::optional<bool> coalesceOpt;
+  // when the request was written to a pooled connection
+  std::chrono::steady_clock::time_point poolSampleTime;
+  /* endAsync handlers run on the strand, so a deadline or cancel() can close
+   * the socket of the attempt in flight. The members below are only touched
+   * on the strand.
+   */
+  std::unique_ptr<asio::strand<asio::io_context::executor_type>>
+      asyncStrandPtr;
+  std::unique_ptr<asio::steady_timer> deadlineTimerPtr, retryTimerPtr,
+      hedgeTimerPtr;
+  // stale timer handlers compare this
+  uint64_t asyncGeneration;
+  std::chrono::steady_clock::time_point asyncDeadline, asyncAttemptTime;
+  int asyncRetryMax, asyncRetryNum, asyncPrimaryRc;
+  // asyncPrimaryFlag is set until this client's own attempts are over
+  bool asyncCancelFlag, asyncPrimaryFlag, asyncHedgeWonFlag, hedgeRunFlag;
+  std::shared_ptr<ClientPoolWaiter> asyncWaiterPtr;
+  std::shared_ptr<ClientConnector> asyncConnectorPtr;
+  std::shared_ptr<ClientHttp2Connection> asyncHttp2Ptr;
+  std::shared_ptr<ClientHttp2Stream> asyncStreamPtr;
+  std::shared_ptr<ClientImpl> hedgePtr;
+  // response cache, "METHOD scheme://host:port/target"
+  std::string cacheKey;
+  // the stored response a conditional request revalidates
+  std::shared_ptr<ClientCacheEntry> cacheEntryPtr;
+  /* cacheValidatorFlag is set while the request carries validators added by
+   * cacheBegin. cacheRevalidateFlag marks a background revalidation, which
+   * is never answered from the cache.
+   */
+  bool cacheStoreFlag, cacheValidatorFlag, cacheRevalidateFlag;
+  // set while this client leads a coalesced request
+  bool coalesceLeaderFlag;
+  std::string coalesceKey;
 
   // boost beast
-  std::unique_ptr<ssl::stream<tcp::socket>>
-  connect(asio::io_context &ctx, ssl::context &ssl_ctx,
-          std::string const &hostname);
+  /* Everything end() does unless endAsync runs the request */
+  int endSync();
+  int connect(ClientConnection &connection, std::string const &hostname,
+              std::string const &port);
+  /* Counts the attempts of a finished happy eyeballs connect */
+  void countConnect(ClientConnector &);
+  /* "scheme://host:port", or "unix:path", used to share pooled connections */
+  std::string getPoolKey(std::string const &hostname, std::string const &port);
+  /* Hostname verification, SNI, session resumption and ALPN of a TLS
+   * connection
+   */
+  int prepareStream(ClientConnection &connection);
+  /* Counts the handshake and records whether h2 was negotiated */
+  int finishHandshake(ClientConnection &connection);
+  int endHttp2(std::shared_ptr<ClientHttp2Connection>);
+  void asyncHttp2(std::shared_ptr<ClientHttp2Connection>);
+  /* Fills in the request and the pool key from the URL and method */
+  int prepareRequest();
+  /* Opens the body file and sets Content-Length or chunked encoding */
+  int prepareBody();
+  bool isUploading();
+  /* Next part of a streamed body, 0 at the end and -1 on error */
+  std::int64_t readUpload(char *data, std::size_t len);
+  int writeRequest(ClientStream &stream, boost::system::error_code &ec);
+  int newResponse();
+  int parseResponse();
+  /* Reads the response with parserPtr and hands the body to deliverBody in
+   * chunks of bodyBuffer
+   */
+  int readResponse(ClientStream &stream, beast::flat_buffer &buffer,
+                   boost::system::error_code &ec);
+  /* Sends a body chunk to the callback, the file or the in-memory body.
+   * Returns -1 if the request must be aborted.
+   */
+  int deliverBody(const char *data, std::size_t len);
+  /* Writes decoded body bytes, enforcing maxResponseSize */
+  int writeBody(const char *data, std::size_t len);
+  /* Closes the file and releases the decoder. Returns -1 if the encoded body
+   * ended early.
+   */
+  int finishBody();
+  bool isStreaming();
+  /* A failed request may only be retried if no body was delivered */
+  bool isRetryable();
+  bool isIdempotent();
+  /* 502, 503 and 504 responses that were not streamed */
+  bool isRetryStatus();
+  /* Reports the latency since poolSampleTime to the pool's adaptive limit.
+   * A failed request or a 429 or 503 response counts as a drop. The
+   * endpoint of an upstream group gets the sample too, where failures and
+   * 5xx responses count as errors.
+   */
+  void addPoolSample(bool failFlag);
+  /* endAsync runs these in order on the client threads. Each step keeps the
+   * client alive until the request finished.
+   */
+  void asyncBegin(uint64_t generation);
+  /* Starts an attempt, over HTTP/2 if there is a connection */
+  void asyncStart();
+  void asyncAcquire();
+  void asyncConnect();
+  void asyncHandshake();
+  void asyncWrite();
+  void asyncUpload();
+  void asyncRead();
+  void asyncReadBody();
+  /* Drops the connection and retries once like end() or finishes with -1 */
+  void asyncError(std::string what, boost::system::error_code ec);
+  /* Retries the attempt after a backoff if retryFlag is set and the budget
+   * allows it
+   */
+  void asyncAttemptDone(int rc, bool retryFlag);
+  void asyncPrimaryDone(int rc);
+  /* Aborts the attempt in flight. It unwinds to asyncAttemptDone. */
+  void asyncCancelAttempt();
+  void asyncHedge(uint64_t generation);
+  void asyncHedgeDone(std::shared_ptr<ClientImpl>, int rc);
+  /* Takes over the response of the hedged request that won */
+  void adoptResponse(ClientImpl &);
+  void asyncFinish(int rc);
+  /* Answers the request from the cache or adds If-None-Match and
+   * If-Modified-Since for a stale entry. Returns 1 if the response was
+   * served from the cache.
+   */
+  int cacheBegin();
+  /* Stores the response, swaps a 304 for the stored response and
+   * invalidates the URL after unsafe methods
+   */
+  int cacheFinish();
+  /* Sends a conditional copy of the request for stale-while-revalidate */
+  void cacheRevalidate(std::shared_ptr<ClientCacheEntry>);
+  /* Joins an identical request in flight. Returns 1 if this request waits
+   * for it instead of going upstream.
+   */
+  int coalesceBegin();
+  /* Fails the waiting request at its deadline */
+  void coalesceWait(uint64_t generation);
+  /* Stops waiting for the coalesced request. Returns false if this request
+   * does not wait or its response is already on the way.
+   */
+  bool coalesceLeave();
+  /* Takes over the response of the request this one waited for */
+  void coalesceDone(int rc,
+                    std::shared_ptr<http::response<http::string_body>>);
 
 public:
   ClientImpl();
   ClientImpl(std::map<std::string, newClientVariantType> map);
   ~ClientImpl();
   int setSettingsDoc(std::shared_ptr<rapidjson::Value>);
-  int loadSettingsDoc();
+  int setClientState(std::shared_ptr<ClientState>);
   std::string_view url();
   std::string_view getEncodedHost();
   int setURL(std::string);
@@ -76,11 +286,31 @@ public:
   int setHeader(std::map<std::string, std::string>);
   int setCookie(std::map<std::string, std::string>);
   int setMethod(std::string method);
+  int setBody(std::string, std::string);
+  int setForm(std::map<std::string, std::string>);
+  int setJson(const rapidjson::Value &);
+  int setBodyFile(std::string, std::string);
+  int setBodySource(clientBodySourceType, std::string);
+  int setResponseCallback(clientBodyCallbackType);
+  int setResponseFile(std::string);
+  int setProgressCallback(clientProgressCallbackType);
+  int setMaxResponseSize(std::uint64_t);
+  int setTimeout(int);
+  int setRetries(int);
+  int setHedge(bool);
+  int setCoalesce(bool);
+  int setUnixSocket(std::string);
+  int setUpstreamGroup(std::string);
+  int getResponseStatus();
   std::optional<std::string_view> getResponseStr();
   std::optional<std::shared_ptr<rapidjson::Document>> getResponseJson();
+  std::uint64_t getResponseSize();
+  std::uint64_t getResponseEncodedSize();
   int end();
   int endAsync();
+  int endAsync(clientCallbackType);
   int wait();
+  int cancel();
 };
 
 } // namespace HTTP
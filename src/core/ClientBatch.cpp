@@ -0,0 +1,256 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientBatch.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientBatchImpl::ClientBatchImpl() {
+  startNum = activeNum = doneNum = returnNum = 0;
+  runFlag = false;
+  concurrency = 16;
+  deadline = std::chrono::milliseconds(0);
+}
+
+ClientBatchImpl::ClientBatchImpl(
+    std::map<std::string, newClientBatchVariantType> map)
+    : ClientBatchImpl() {
+  for (auto val : map) {
+    if (int *val_ = std::get_if<int>(&val.second)) {
+      if (val.first == "concurrency") {
+        concurrency = std::max<int>(1, *val_);
+      } else if (val.first == "deadline") {
+        deadline = std::chrono::milliseconds(std::max<int>(0, *val_));
+      }
+    }
+  }
+}
+
+ClientBatchImpl::~ClientBatchImpl() {}
+
+int ClientBatchImpl::setSettingsDoc(
+    std::shared_ptr<rapidjson::Value> settingsDoc_) {
+  settingsDoc = settingsDoc_;
+  return 0;
+}
+
+int ClientBatchImpl::setClientState(
+    std::shared_ptr<ClientState> clientState_) {
+  clientState = clientState_;
+  return 0;
+}
+
+int ClientBatchImpl::add(std::shared_ptr<Client> clientPtr) {
+  const std::lock_guard<std::mutex> lock(batchMutex);
+  if (runFlag) {
+    logStatus("::ClientBatchImpl::add",
+              "ERROR: requests can not be added after endAsync");
+    return -1;
+  }
+  clientList.push_back(clientPtr);
+  rcList.push_back(-1);
+  doneFlagList.push_back(false);
+  return static_cast<int>(clientList.size()) - 1;
+}
+
+int ClientBatchImpl::add(std::map<std::string, newClientVariantType> map) {
+  std::shared_ptr<ClientImpl> clientPtr = std::make_shared<ClientImpl>(map);
+  clientPtr->setSettingsDoc(settingsDoc);
+  clientPtr->setClientState(clientState);
+  return add(std::dynamic_pointer_cast<Client>(clientPtr));
+}
+
+std::shared_ptr<Client> ClientBatchImpl::getClient(int index) {
+  const std::lock_guard<std::mutex> lock(batchMutex);
+  if (index < 0 || index >= static_cast<int>(clientList.size())) {
+    return nullptr;
+  }
+  return clientList[index];
+}
+
+int ClientBatchImpl::getResult(int index) {
+  const std::lock_guard<std::mutex> lock(batchMutex);
+  if (index < 0 || index >= static_cast<int>(rcList.size()) ||
+      !doneFlagList[index]) {
+    return -1;
+  }
+  return rcList[index];
+}
+
+int ClientBatchImpl::end() {
+  if (!clientState->canWaitOnIo()) {
+    // the requests are only completed by the client threads
+    logStatus("::ClientBatchImpl::end",
+              "ERROR: can not wait on the client threads from this thread");
+    return -1;
+  }
+  if (endAsync() < 0) {
+    return -1;
+  }
+  return wait();
+}
+
+int ClientBatchImpl::endAsync() { return endAsync(nullptr); }
+
+int ClientBatchImpl::endAsync(clientBatchCallbackType callback) {
+  {
+    const std::lock_guard<std::mutex> lock(batchMutex);
+    if (runFlag) {
+      logStatus("::ClientBatchImpl::endAsync",
+                "ERROR: the batch was already started");
+      return -1;
+    }
+    runFlag = true;
+    batchCallback = std::move(callback);
+    if (deadline.count() > 0 && !clientList.empty()) {
+      auto self = shared_from_this();
+      deadlineTimerPtr =
+          std::make_unique<boost::asio::steady_timer>(clientState->ioContext);
+      deadlineTimerPtr->expires_after(deadline);
+      deadlineTimerPtr->async_wait([self](boost::system::error_code ec) {
+        if (!ec) {
+          self->onDeadline();
+        }
+      });
+    }
+  }
+  batchCondition.notify_all();
+  startNext();
+  return 0;
+}
+
+void ClientBatchImpl::startNext() {
+  std::vector<int> startList;
+  {
+    const std::lock_guard<std::mutex> lock(batchMutex);
+    while (activeNum < concurrency && startNum < clientList.size() &&
+           doneNum < clientList.size()) {
+      if (!doneFlagList[startNum]) {
+        startList.push_back(static_cast<int>(startNum));
+        activeNum++;
+      }
+      startNum++;
+    }
+  }
+  auto self = shared_from_this();
+  for (int index : startList) {
+    int rc = clientList[index]->endAsync(
+        [self, index](int rc) { self->onComplete(index, rc); });
+    if (rc < 0) {
+      onComplete(index, -1);
+    }
+  }
+}
+
+void ClientBatchImpl::onComplete(int index, int rc) {
+  clientBatchCallbackType callback;
+  {
+    const std::lock_guard<std::mutex> lock(batchMutex);
+    activeNum--;
+    if (doneFlagList[index]) {
+      // already failed by the deadline
+      return;
+    }
+    doneFlagList[index] = true;
+    rcList[index] = rc;
+    doneNum++;
+    completedList.push_back(index);
+    if (doneNum == clientList.size() && deadlineTimerPtr) {
+      deadlineTimerPtr->cancel();
+    }
+    callback = batchCallback;
+  }
+  if (callback) {
+    callback(index, rc);
+  }
+  batchCondition.notify_all();
+  startNext();
+}
+
+void ClientBatchImpl::onDeadline() {
+  std::vector<int> expiredList;
+  clientBatchCallbackType callback;
+  {
+    const std::lock_guard<std::mutex> lock(batchMutex);
+    for (std::size_t index = 0; index < clientList.size(); index++) {
+      if (!doneFlagList[index]) {
+        doneFlagList[index] = true;
+        rcList[index] = -1;
+        doneNum++;
+        completedList.push_back(static_cast<int>(index));
+        expiredList.push_back(static_cast<int>(index));
+      }
+    }
+    callback = batchCallback;
+  }
+  if (expiredList.empty()) {
+    return;
+  }
+  logStatus("::ClientBatchImpl::onDeadline",
+            "ERROR: " + std::to_string(expiredList.size()) +
+                " requests did not finish before the deadline");
+  for (int index : expiredList) {
+    // frees the connection slots of requests still in flight
+    clientList[index]->cancel();
+  }
+  if (callback) {
+    for (int index : expiredList) {
+      callback(index, -1);
+    }
+  }
+  batchCondition.notify_all();
+}
+
+int ClientBatchImpl::next() {
+  if (!clientState->canWaitOnIo()) {
+    logStatus("::ClientBatchImpl::next",
+              "ERROR: can not wait on the client threads from this thread");
+    return -1;
+  }
+  std::unique_lock<std::mutex> lock(batchMutex);
+  if (!runFlag) {
+    return -1;
+  }
+  batchCondition.wait(lock, [this] {
+    return !completedList.empty() || returnNum == clientList.size();
+  });
+  if (completedList.empty()) {
+    return -1;
+  }
+  int index = completedList.front();
+  completedList.pop_front();
+  returnNum++;
+  return index;
+}
+
+int ClientBatchImpl::wait() {
+  if (!clientState->canWaitOnIo()) {
+    logStatus("::ClientBatchImpl::wait",
+              "ERROR: can not wait on the client threads from this thread");
+    return -1;
+  }
+  std::unique_lock<std::mutex> lock(batchMutex);
+  if (!runFlag) {
+    return -1;
+  }
+  batchCondition.wait(lock, [this] { return doneNum == clientList.size(); });
+  for (int rc : rcList) {
+    if (rc < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
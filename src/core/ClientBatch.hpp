@@ -0,0 +1,91 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_BATCH_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_BATCH_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/steady_timer.hpp>
+
+// Local Project
+#include "Client.hpp"
+#include "ClientState.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Fans requests out with Client::endAsync and collects them as they finish.
+ * The deadline timer is only touched while batchMutex is held.
+ */
+class ClientBatchImpl : public ClientBatch,
+                        public std::enable_shared_from_this<ClientBatchImpl> {
+private:
+  std::shared_ptr<rapidjson::Value> settingsDoc;
+  std::shared_ptr<ClientState> clientState;
+  std::mutex batchMutex;
+  std::condition_variable batchCondition;
+  std::vector<std::shared_ptr<Client>> clientList;
+  std::vector<int> rcList;
+  std::vector<bool> doneFlagList;
+  // finished requests not yet returned by next()
+  std::deque<int> completedList;
+  std::size_t startNum, activeNum, doneNum, returnNum;
+  bool runFlag;
+  clientBatchCallbackType batchCallback;
+  std::unique_ptr<boost::asio::steady_timer> deadlineTimerPtr;
+  /* Starts requests until concurrency of them are in flight */
+  void startNext();
+  void onComplete(int index, int rc);
+  /* Fails every request that has not finished yet */
+  void onDeadline();
+
+public:
+  ClientBatchImpl();
+  ClientBatchImpl(std::map<std::string, newClientBatchVariantType> map);
+  ~ClientBatchImpl();
+  int setSettingsDoc(std::shared_ptr<rapidjson::Value>);
+  int setClientState(std::shared_ptr<ClientState>);
+  std::size_t concurrency;
+  // zero means no deadline
+  std::chrono::milliseconds deadline;
+  int add(std::shared_ptr<Client>);
+  int add(std::map<std::string, newClientVariantType>);
+  std::shared_ptr<Client> getClient(int);
+  int getResult(int);
+  int end();
+  int endAsync();
+  int endAsync(clientBatchCallbackType);
+  int next();
+  int wait();
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_BATCH_H
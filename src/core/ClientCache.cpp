@@ -0,0 +1,371 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <algorithm>
+
+// Local Project
+#include "ClientCache.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+namespace http = boost::beast::http;
+
+ClientCacheEntry::ClientCacheEntry() {
+  size = 0;
+  ageAtStore = freshLifetime = staleWhileRevalidate = std::chrono::seconds(0);
+  noCacheFlag = revalidateFlag = sharedFlag = false;
+}
+ClientCacheEntry::~ClientCacheEntry() {}
+
+ClientCache::ClientCache() {
+  maxSize = 33554432;
+  totalSize = 0;
+  hitNum = staleHitNum = missNum = revalidateNum = notModifiedNum = storeNum =
+      evictNum = 0;
+}
+ClientCache::~ClientCache() {}
+
+bool ClientCache::isEnabled() { return maxSize > 0; }
+
+void ClientCache::setMaxSize(std::size_t maxSize_) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  maxSize = maxSize_;
+  while (totalSize > maxSize_ && !lruList.empty()) {
+    erase(lruList.back());
+    evictNum++;
+  }
+}
+
+std::map<std::string, std::string>
+ClientCache::parseCacheControl(std::string_view value) {
+  std::map<std::string, std::string> directiveMap;
+  std::vector<std::string> directiveList;
+  boost::split(directiveList, value, boost::is_any_of(","));
+  for (auto &directive : directiveList) {
+    std::string argument;
+    std::size_t pos = directive.find('=');
+    if (pos != std::string::npos) {
+      argument = directive.substr(pos + 1);
+      directive.resize(pos);
+      boost::trim(argument);
+      boost::trim_if(argument, boost::is_any_of("\""));
+    }
+    boost::trim(directive);
+    boost::to_lower(directive);
+    if (!directive.empty()) {
+      directiveMap[directive] = argument;
+    }
+  }
+  return directiveMap;
+}
+
+bool ClientCache::hasCredentials(
+    const http::request<http::string_body> &requestBeast) {
+  return requestBeast.find(http::field::authorization) != requestBeast.end() ||
+         requestBeast.find(http::field::cookie) != requestBeast.end();
+}
+
+void ClientCache::setFreshness(
+    ClientCacheEntry &entry,
+    const http::response<http::string_body> &responseBeast,
+    const http::fields *notModifiedFields) {
+  auto field = [&](http::field name) -> std::string_view {
+    if (notModifiedFields) {
+      auto it = notModifiedFields->find(name);
+      if (it != notModifiedFields->end()) {
+        return std::string_view(it->value().data(), it->value().size());
+      }
+    }
+    auto it = responseBeast.find(name);
+    if (it == responseBeast.end()) {
+      return std::string_view();
+    }
+    return std::string_view(it->value().data(), it->value().size());
+  };
+  auto toSeconds = [](const std::string &str) {
+    try {
+      return std::chrono::seconds(std::max<long long>(0, std::stoll(str)));
+    } catch (...) {
+      return std::chrono::seconds(0);
+    }
+  };
+  auto now = std::chrono::system_clock::now();
+  auto dateOpt = parseHttpDate(field(http::field::date));
+  auto date = dateOpt.value_or(now);
+  auto directiveMap = parseCacheControl(field(http::field::cache_control));
+
+  // the larger of the apparent age and the Age header, RFC 7234 4.2.3
+  std::chrono::seconds apparentAge =
+      std::max(std::chrono::seconds(0),
+               std::chrono::duration_cast<std::chrono::seconds>(now - date));
+  std::chrono::seconds ageValue =
+      toSeconds(std::string(field(http::field::age)));
+  entry.ageAtStore = std::max(apparentAge, ageValue);
+  entry.storeTime = std::chrono::steady_clock::now();
+  entry.noCacheFlag = directiveMap.count("no-cache") > 0;
+  entry.staleWhileRevalidate = std::chrono::seconds(0);
+  if (directiveMap.count("stale-while-revalidate") &&
+      !directiveMap.count("must-revalidate")) {
+    entry.staleWhileRevalidate =
+        toSeconds(directiveMap["stale-while-revalidate"]);
+  }
+
+  // s-maxage overrides max-age in a shared cache
+  if (directiveMap.count("s-maxage")) {
+    entry.freshLifetime = toSeconds(directiveMap["s-maxage"]);
+    return;
+  }
+  if (directiveMap.count("max-age")) {
+    entry.freshLifetime = toSeconds(directiveMap["max-age"]);
+    return;
+  }
+  std::string_view expires = field(http::field::expires);
+  if (!expires.empty()) {
+    // an invalid date means already expired
+    auto expiresOpt = parseHttpDate(expires);
+    entry.freshLifetime =
+        expiresOpt ? std::max(std::chrono::seconds(0),
+                              std::chrono::duration_cast<std::chrono::seconds>(
+                                  *expiresOpt - date))
+                   : std::chrono::seconds(0);
+    return;
+  }
+  // heuristic freshness, a tenth of the time since the last modification
+  entry.freshLifetime = std::chrono::seconds(0);
+  auto lastModifiedOpt = parseHttpDate(field(http::field::last_modified));
+  if (lastModifiedOpt && *lastModifiedOpt < date) {
+    entry.freshLifetime = std::min<std::chrono::seconds>(
+        std::chrono::hours(24),
+        std::chrono::duration_cast<std::chrono::seconds>(date -
+                                                         *lastModifiedOpt) /
+            10);
+  }
+}
+
+std::shared_ptr<ClientCacheEntry>
+ClientCache::lookup(const std::string &key,
+                    const http::request<http::string_body> &requestBeast,
+                    clientCacheState &state) {
+  const bool credentialFlag = hasCredentials(requestBeast);
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  auto mapIt = entryMap.find(key);
+  if (mapIt != entryMap.end()) {
+    for (auto &entryPtr : mapIt->second) {
+      // another caller's response, or an anonymous one, RFC 7234 3.2
+      if (credentialFlag && !entryPtr->sharedFlag) {
+        continue;
+      }
+      bool matchFlag = true;
+      for (std::size_t i = 0; i < entryPtr->varyList.size() && matchFlag;
+           i++) {
+        auto it = requestBeast.find(entryPtr->varyList[i]);
+        std::string value =
+            it == requestBeast.end() ? "" : std::string(it->value());
+        matchFlag = value == entryPtr->varyValueList[i];
+      }
+      if (!matchFlag) {
+        continue;
+      }
+      lruList.splice(lruList.begin(), lruList, entryPtr->lruIt);
+      auto age = entryPtr->ageAtStore +
+                 std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::steady_clock::now() - entryPtr->storeTime);
+      if (!entryPtr->noCacheFlag && age < entryPtr->freshLifetime) {
+        hitNum++;
+        state = clientCacheState::fresh;
+      } else if (!entryPtr->noCacheFlag &&
+                 age < entryPtr->freshLifetime +
+                           entryPtr->staleWhileRevalidate) {
+        staleHitNum++;
+        state = clientCacheState::staleWhileRevalidate;
+      } else {
+        revalidateNum++;
+        state = clientCacheState::stale;
+      }
+      return entryPtr;
+    }
+  }
+  missNum++;
+  return nullptr;
+}
+
+int ClientCache::store(
+    const std::string &key,
+    const http::request<http::string_body> &requestBeast,
+    std::shared_ptr<http::response<http::string_body>> responseBeast) {
+  switch (responseBeast->result_int()) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 308:
+  case 404:
+  case 405:
+  case 410:
+  case 414:
+  case 501:
+    break;
+  default:
+    return 0;
+  }
+  auto directiveMap = parseCacheControl(
+      std::string(responseBeast->base()[http::field::cache_control]));
+  // the cache is shared by every caller of the module
+  if (directiveMap.count("no-store") || directiveMap.count("private")) {
+    return 0;
+  }
+  const bool sharedFlag =
+      directiveMap.count("public") > 0 || directiveMap.count("s-maxage") > 0;
+  if (hasCredentials(requestBeast) && !sharedFlag) {
+    return 0;
+  }
+  auto entryPtr = std::make_shared<ClientCacheEntry>();
+  entryPtr->sharedFlag = sharedFlag;
+  entryPtr->key = key;
+  entryPtr->responseBeast = responseBeast;
+  entryPtr->etag = std::string(responseBeast->base()[http::field::etag]);
+  entryPtr->lastModified =
+      std::string(responseBeast->base()[http::field::last_modified]);
+  std::vector<std::string> varyList;
+  std::string vary = std::string(responseBeast->base()[http::field::vary]);
+  boost::split(varyList, vary, boost::is_any_of(","));
+  for (auto &name : varyList) {
+    boost::trim(name);
+    boost::to_lower(name);
+    if (name == "*") {
+      // never matches a later request
+      return 0;
+    }
+    if (!name.empty()) {
+      auto it = requestBeast.find(name);
+      entryPtr->varyList.push_back(name);
+      entryPtr->varyValueList.push_back(
+          it == requestBeast.end() ? "" : std::string(it->value()));
+    }
+  }
+  setFreshness(*entryPtr, *responseBeast, nullptr);
+  if (entryPtr->freshLifetime.count() == 0 && entryPtr->etag.empty() &&
+      entryPtr->lastModified.empty()) {
+    // could neither be served nor revalidated
+    return 0;
+  }
+  entryPtr->size = key.size() + responseBeast->body().size() + 256;
+  for (auto &field : responseBeast->base()) {
+    entryPtr->size += field.name_string().size() + field.value().size() + 4;
+  }
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  // one large response may not flush the whole cache
+  if (entryPtr->size > maxSize / 8) {
+    return 0;
+  }
+  auto &variantList = entryMap[key];
+  for (auto &variantPtr : variantList) {
+    if (variantPtr->varyList == entryPtr->varyList &&
+        variantPtr->varyValueList == entryPtr->varyValueList) {
+      erase(variantPtr);
+      break;
+    }
+  }
+  entryMap[key].push_back(entryPtr);
+  lruList.push_front(entryPtr);
+  entryPtr->lruIt = lruList.begin();
+  totalSize += entryPtr->size;
+  storeNum++;
+  while (totalSize > maxSize && !lruList.empty()) {
+    erase(lruList.back());
+    evictNum++;
+  }
+  return 0;
+}
+
+int ClientCache::update(std::shared_ptr<ClientCacheEntry> entryPtr,
+                        const http::fields &notModifiedFields) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  notModifiedNum++;
+  setFreshness(*entryPtr, *entryPtr->responseBeast, &notModifiedFields);
+  return 0;
+}
+
+void ClientCache::erase(std::shared_ptr<ClientCacheEntry> entryPtr) {
+  auto mapIt = entryMap.find(entryPtr->key);
+  if (mapIt == entryMap.end()) {
+    return;
+  }
+  auto &variantList = mapIt->second;
+  auto it = std::find(variantList.begin(), variantList.end(), entryPtr);
+  if (it == variantList.end()) {
+    return;
+  }
+  variantList.erase(it);
+  if (variantList.empty()) {
+    entryMap.erase(mapIt);
+  }
+  lruList.erase(entryPtr->lruIt);
+  totalSize -= entryPtr->size;
+}
+
+int ClientCache::invalidate(const std::string &key) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  auto mapIt = entryMap.find(key);
+  if (mapIt == entryMap.end()) {
+    return 0;
+  }
+  auto variantList = mapIt->second;
+  for (auto &entryPtr : variantList) {
+    erase(entryPtr);
+  }
+  return 0;
+}
+
+bool ClientCache::beginRevalidate(std::shared_ptr<ClientCacheEntry> entryPtr) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  if (entryPtr->revalidateFlag) {
+    return false;
+  }
+  entryPtr->revalidateFlag = true;
+  return true;
+}
+
+void ClientCache::endRevalidate(std::shared_ptr<ClientCacheEntry> entryPtr) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  entryPtr->revalidateFlag = false;
+}
+
+int ClientCache::clear() {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  entryMap.clear();
+  lruList.clear();
+  totalSize = 0;
+  return 0;
+}
+
+int ClientCache::getStats(rapidjson::Value &statsValue,
+                          rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  statsValue.SetObject();
+  statsValue.AddMember("hits", hitNum, allocator);
+  statsValue.AddMember("staleHits", staleHitNum, allocator);
+  statsValue.AddMember("misses", missNum, allocator);
+  statsValue.AddMember("revalidations", revalidateNum, allocator);
+  statsValue.AddMember("notModified", notModifiedNum, allocator);
+  statsValue.AddMember("stores", storeNum, allocator);
+  statsValue.AddMember("evictions", evictNum, allocator);
+  statsValue.AddMember("entries", static_cast<uint64_t>(lruList.size()),
+                       allocator);
+  statsValue.AddMember("bytes", static_cast<uint64_t>(totalSize), allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,152 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CACHE_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CACHE_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/string_body.hpp>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+enum class clientCacheState { fresh, staleWhileRevalidate, stale };
+
+class ClientCacheEntry {
+public:
+  ClientCacheEntry();
+  ~ClientCacheEntry();
+  std::string key;
+  /* Shared with every client served from the entry and never modified. A
+   * 304 only updates the freshness members below.
+   */
+  std::shared_ptr<
+      boost::beast::http::response<boost::beast::http::string_body>>
+      responseBeast;
+  std::string etag, lastModified;
+  // lower case header names from Vary and the request's values of them
+  std::vector<std::string> varyList, varyValueList;
+  std::size_t size;
+  // guarded by cacheMutex
+  std::chrono::steady_clock::time_point storeTime;
+  std::chrono::seconds ageAtStore, freshLifetime, staleWhileRevalidate;
+  bool noCacheFlag, revalidateFlag;
+  // public or s-maxage, may be served to requests carrying credentials
+  bool sharedFlag;
+  std::list<std::shared_ptr<ClientCacheEntry>>::iterator lruIt;
+};
+
+/* RFC 7234 shared cache used by every client. Entries are keyed by the
+ * method and URL, with one variant per combination of the Vary request
+ * headers. Stored responses are shared by the clients served from them. The
+ * least recently used entries are evicted once maxSize bytes are stored.
+ * Private responses are never stored and requests carrying Authorization or
+ * Cookie are only served public responses, RFC 7234 3.2.
+ */
+class ClientCache {
+private:
+  std::mutex cacheMutex;
+  std::unordered_map<std::string,
+                     std::vector<std::shared_ptr<ClientCacheEntry>>>
+      entryMap;
+  // most recently used first
+  std::list<std::shared_ptr<ClientCacheEntry>> lruList;
+  std::size_t totalSize;
+  // zero disables the cache, written under cacheMutex
+  std::atomic<std::size_t> maxSize;
+  // statistics
+  uint64_t hitNum, staleHitNum, missNum, revalidateNum, notModifiedNum,
+      storeNum, evictNum;
+  /* Reads Cache-Control, Expires, Date, Age and Last-Modified. Fields of the
+   * 304 response take precedence over those of the stored one.
+   */
+  void setFreshness(
+      ClientCacheEntry &,
+      const boost::beast::http::response<boost::beast::http::string_body> &,
+      const boost::beast::http::fields *notModifiedFields);
+  /* Removes the entry. cacheMutex must be held. */
+  void erase(std::shared_ptr<ClientCacheEntry>);
+
+public:
+  ClientCache();
+  ~ClientCache();
+  bool isEnabled();
+  /* Evicts the least recently used entries above the new size */
+  void setMaxSize(std::size_t);
+  /* Returns the variant matching the request's Vary headers, or nullptr */
+  std::shared_ptr<ClientCacheEntry>
+  lookup(const std::string &key,
+         const boost::beast::http::request<boost::beast::http::string_body> &,
+         clientCacheState &state);
+  /* Stores the response if it is cacheable. It must not be modified
+   * afterwards.
+   */
+  int store(
+      const std::string &key,
+      const boost::beast::http::request<boost::beast::http::string_body> &,
+      std::shared_ptr<
+          boost::beast::http::response<boost::beast::http::string_body>>
+          responseBeast);
+  /* Refreshes the entry from a 304 response */
+  int update(std::shared_ptr<ClientCacheEntry>,
+             const boost::beast::http::fields &notModifiedFields);
+  /* Removes every variant of the key, used after unsafe requests */
+  int invalidate(const std::string &key);
+  /* True if the caller should revalidate the entry in the background. Only
+   * one revalidation of an entry runs at a time.
+   */
+  bool beginRevalidate(std::shared_ptr<ClientCacheEntry>);
+  void endRevalidate(std::shared_ptr<ClientCacheEntry>);
+  int clear();
+  /* Splits a Cache-Control value into lower case directives and their
+   * unquoted arguments
+   */
+  static std::map<std::string, std::string>
+  parseCacheControl(std::string_view);
+  /* True if the request carries Authorization or Cookie */
+  static bool hasCredentials(
+      const boost::beast::http::request<boost::beast::http::string_body> &);
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CACHE_H
@@ -0,0 +1,142 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientConnector.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientConnector::ClientConnector(boost::asio::io_context &ioContext_,
+                                 std::chrono::milliseconds staggerDelay_)
+    : ioContext(ioContext_), strand(boost::asio::make_strand(ioContext_)),
+      staggerTimer(ioContext_) {
+  staggerDelay = staggerDelay_;
+  winnerIndex = -1;
+  pendingNum = 0;
+  doneFlag = false;
+}
+ClientConnector::~ClientConnector() {}
+
+void ClientConnector::start(
+    const boost::asio::ip::tcp::resolver::results_type &results,
+    connectHandlerType handler_) {
+  handler = std::move(handler_);
+  // the family of the first address goes first, RFC 8305 section 4
+  std::vector<boost::asio::ip::tcp::endpoint> firstList, secondList;
+  for (auto &entry : results) {
+    if (firstList.empty() ||
+        entry.endpoint().protocol() == firstList.front().protocol()) {
+      firstList.push_back(entry.endpoint());
+    } else {
+      secondList.push_back(entry.endpoint());
+    }
+  }
+  for (std::size_t i = 0; i < std::max(firstList.size(), secondList.size());
+       i++) {
+    if (i < firstList.size()) {
+      endpointList.push_back(firstList[i]);
+    }
+    if (i < secondList.size()) {
+      endpointList.push_back(secondList[i]);
+    }
+  }
+  auto self = shared_from_this();
+  boost::asio::post(strand, [self]() {
+    if (self->endpointList.empty()) {
+      self->finish(boost::asio::error::host_not_found,
+                   boost::asio::ip::tcp::socket(self->ioContext));
+      return;
+    }
+    self->startNext();
+  });
+}
+
+void ClientConnector::startNext() {
+  if (doneFlag || socketList.size() >= endpointList.size()) {
+    return;
+  }
+  const std::size_t index = socketList.size();
+  socketList.push_back(
+      std::make_unique<boost::asio::ip::tcp::socket>(ioContext));
+  pendingNum++;
+  auto self = shared_from_this();
+  socketList[index]->async_connect(
+      endpointList[index],
+      boost::asio::bind_executor(
+          strand, [self, index](boost::system::error_code ec) {
+            self->onConnect(index, ec);
+          }));
+  if (socketList.size() < endpointList.size()) {
+    staggerTimer.expires_after(staggerDelay);
+    staggerTimer.async_wait(boost::asio::bind_executor(
+        strand, [self](boost::system::error_code ec) {
+          if (!ec) {
+            self->startNext();
+          }
+        }));
+  }
+}
+
+void ClientConnector::onConnect(std::size_t index,
+                                boost::system::error_code ec) {
+  pendingNum--;
+  if (doneFlag) {
+    return;
+  }
+  if (!ec) {
+    winnerIndex = static_cast<int>(index);
+    finish({}, std::move(*socketList[index]));
+    return;
+  }
+  lastEc = ec;
+  boost::system::error_code closeEc;
+  socketList[index]->close(closeEc);
+  if (socketList.size() < endpointList.size()) {
+    // a failed attempt does not wait for the stagger delay
+    staggerTimer.cancel();
+    startNext();
+    return;
+  }
+  if (pendingNum == 0) {
+    finish(lastEc, boost::asio::ip::tcp::socket(ioContext));
+  }
+}
+
+void ClientConnector::finish(boost::system::error_code ec,
+                             boost::asio::ip::tcp::socket socket) {
+  doneFlag = true;
+  staggerTimer.cancel();
+  // the losing attempts complete with operation_aborted
+  for (auto &socketPtr : socketList) {
+    boost::system::error_code closeEc;
+    socketPtr->close(closeEc);
+  }
+  connectHandlerType finishHandler;
+  finishHandler.swap(handler);
+  finishHandler(ec, std::move(socket));
+}
+
+void ClientConnector::cancel() {
+  auto self = shared_from_this();
+  boost::asio::post(strand, [self]() {
+    if (self->doneFlag) {
+      return;
+    }
+    self->finish(boost::asio::error::operation_aborted,
+                 boost::asio::ip::tcp::socket(self->ioContext));
+  });
+}
+
+std::size_t ClientConnector::getAttemptNum() { return socketList.size(); }
+
+} // namespace HTTP
+} // namespace bookfiler
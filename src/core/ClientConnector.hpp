@@ -0,0 +1,85 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CONNECTOR_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CONNECTOR_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+// called once with the connected socket or the last error
+using connectHandlerType =
+    std::function<void(boost::system::error_code, boost::asio::ip::tcp::socket)>;
+
+/* Connects to one of the resolved addresses with RFC 8305 happy eyeballs.
+ * The addresses are interleaved by family, keeping the resolver's order
+ * within each. A new attempt starts every staggerDelay, or as soon as the
+ * last one failed, while earlier attempts keep running. The first socket to
+ * connect wins and the other attempts are closed. Runs on its own strand.
+ */
+class ClientConnector : public std::enable_shared_from_this<ClientConnector> {
+private:
+  boost::asio::io_context &ioContext;
+  boost::asio::strand<boost::asio::io_context::executor_type> strand;
+  boost::asio::steady_timer staggerTimer;
+  std::vector<boost::asio::ip::tcp::endpoint> endpointList;
+  std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> socketList;
+  std::size_t pendingNum;
+  bool doneFlag;
+  boost::system::error_code lastEc;
+  connectHandlerType handler;
+  /* Starts the attempt on the next address and arms the stagger timer */
+  void startNext();
+  void onConnect(std::size_t index, boost::system::error_code ec);
+  void finish(boost::system::error_code, boost::asio::ip::tcp::socket);
+
+public:
+  ClientConnector(boost::asio::io_context &, std::chrono::milliseconds);
+  ~ClientConnector();
+  std::chrono::milliseconds staggerDelay;
+  // index of the address that connected, -1 until one did
+  int winnerIndex;
+  void start(const boost::asio::ip::tcp::resolver::results_type &,
+             connectHandlerType);
+  /* Closes every attempt, the handler gets operation_aborted */
+  void cancel();
+  // attempts started so far
+  std::size_t getAttemptNum();
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_CONNECTOR_H
@@ -0,0 +1,187 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientDecoder.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+namespace {
+
+// idle inflate states of this thread
+struct InflateFreeList {
+  std::vector<std::unique_ptr<z_stream>> streamList;
+  ~InflateFreeList() {
+    for (auto &streamPtr : streamList) {
+      inflateEnd(streamPtr.get());
+    }
+  }
+};
+thread_local InflateFreeList inflateFreeList;
+const std::size_t inflateFreeListMax = 4;
+
+} // namespace
+
+ClientDecoder::ClientDecoder() {
+  gzipFlag = rawFlag = doneFlag = memberFlag = trailFlag = false;
+}
+
+ClientDecoder::~ClientDecoder() { finish(); }
+
+int ClientDecoder::begin(std::string_view contentEncoding) {
+  finish();
+  doneFlag = memberFlag = trailFlag = false;
+  // only a single coding is supported, as sent by practically every server
+  if (contentEncoding.empty() || contentEncoding == "identity") {
+    return 0;
+  }
+  if (contentEncoding == "gzip" || contentEncoding == "x-gzip") {
+    gzipFlag = true;
+  } else if (contentEncoding == "deflate") {
+    gzipFlag = false;
+  } else {
+    // other codings were asked for by the caller and are passed through
+    return 0;
+  }
+  rawFlag = false;
+  if (!inflateFreeList.streamList.empty()) {
+    streamPtr = std::move(inflateFreeList.streamList.back());
+    inflateFreeList.streamList.pop_back();
+    if (resetStream() < 0) {
+      return -1;
+    }
+  } else {
+    streamPtr = std::make_unique<z_stream>();
+    streamPtr->zalloc = Z_NULL;
+    streamPtr->zfree = Z_NULL;
+    streamPtr->opaque = Z_NULL;
+    streamPtr->next_in = Z_NULL;
+    streamPtr->avail_in = 0;
+    // the window bits are set per response by resetStream
+    if (inflateInit2(streamPtr.get(), 15) != Z_OK) {
+      logStatus("::ClientDecoder::begin", "ERROR: inflateInit2 failed");
+      streamPtr.reset();
+      return -1;
+    }
+    if (resetStream() < 0) {
+      return -1;
+    }
+  }
+  return 1;
+}
+
+int ClientDecoder::resetStream() {
+  int windowBits = gzipFlag ? 16 + MAX_WBITS : MAX_WBITS;
+  if (rawFlag) {
+    windowBits = -MAX_WBITS;
+  }
+  if (inflateReset2(streamPtr.get(), windowBits) != Z_OK) {
+    logStatus("::ClientDecoder::resetStream", "ERROR: inflateReset2 failed");
+    inflateEnd(streamPtr.get());
+    streamPtr.reset();
+    return -1;
+  }
+  return 0;
+}
+
+bool ClientDecoder::isActive() { return streamPtr != nullptr; }
+
+bool ClientDecoder::isDone() { return !streamPtr || doneFlag; }
+
+int ClientDecoder::write(const char *data, std::size_t len,
+                         const decoderOutputType &output) {
+  if (!streamPtr || trailFlag || len == 0) {
+    return 0;
+  }
+  if (doneFlag) {
+    if (!gzipFlag) {
+      // trailing bytes after the end of the stream are ignored
+      return 0;
+    }
+    if (nextMember() < 0) {
+      return -1;
+    }
+  }
+  const bool firstFlag = streamPtr->total_in == 0;
+  streamPtr->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  streamPtr->avail_in = static_cast<uInt>(len);
+  // inflate until it has room left, then all input was consumed
+  for (;;) {
+    streamPtr->next_out = reinterpret_cast<Bytef *>(outBuffer.data());
+    streamPtr->avail_out = static_cast<uInt>(outBuffer.size());
+    int rc = inflate(streamPtr.get(), Z_NO_FLUSH);
+    if (rc == Z_DATA_ERROR && firstFlag && !gzipFlag && !rawFlag) {
+      // some servers send deflate without the zlib header
+      rawFlag = true;
+      if (resetStream() < 0) {
+        return -1;
+      }
+      return write(data, len, output);
+    }
+    if (rc == Z_DATA_ERROR && memberFlag && streamPtr->total_in <= 2) {
+      // no gzip magic, padding after the last member that gzip(1) ignores
+      doneFlag = trailFlag = true;
+      return 0;
+    }
+    if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+      logStatus("::ClientDecoder::write",
+                std::string("ERROR: inflate failed, ") +
+                    (streamPtr->msg ? streamPtr->msg : "no message"));
+      return -1;
+    }
+    std::size_t outLen = outBuffer.size() - streamPtr->avail_out;
+    if (outLen > 0 && output(outBuffer.data(), outLen) < 0) {
+      return -1;
+    }
+    if (rc == Z_STREAM_END) {
+      doneFlag = true;
+      if (!gzipFlag || streamPtr->avail_in == 0) {
+        break;
+      }
+      if (nextMember() < 0) {
+        return -1;
+      }
+      continue;
+    }
+    if (streamPtr->avail_out != 0) {
+      break;
+    }
+  }
+  return 0;
+}
+
+int ClientDecoder::nextMember() {
+  // concatenated gzip members decode to one body, RFC 1952 2.2
+  if (inflateReset(streamPtr.get()) != Z_OK) {
+    logStatus("::ClientDecoder::nextMember", "ERROR: inflateReset failed");
+    return -1;
+  }
+  doneFlag = false;
+  memberFlag = true;
+  return 0;
+}
+
+int ClientDecoder::finish() {
+  if (!streamPtr) {
+    return 0;
+  }
+  if (inflateFreeList.streamList.size() < inflateFreeListMax) {
+    inflateFreeList.streamList.push_back(std::move(streamPtr));
+  } else {
+    inflateEnd(streamPtr.get());
+  }
+  streamPtr.reset();
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
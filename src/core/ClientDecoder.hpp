@@ -0,0 +1,73 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_DECODER_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_DECODER_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <array>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/* zlib 1.2.11
+ * License: zlib License
+ */
+#include <zlib.h>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+// receives the decoded body, -1 stops decoding
+using decoderOutputType = std::function<int(const char *, std::size_t)>;
+
+/* Inflates a gzip or deflate Content-Encoding as the body arrives.
+ * Inflate states are returned to a per-thread free list when the response
+ * finished, so the 32 KB window is only allocated once per thread.
+ */
+class ClientDecoder {
+private:
+  std::unique_ptr<z_stream> streamPtr;
+  bool gzipFlag, rawFlag, doneFlag;
+  // decoding a gzip member after the first, ignoring bytes after the last
+  bool memberFlag, trailFlag;
+  std::array<char, 16384> outBuffer;
+  int resetStream();
+  /* Starts the next member of a gzip body */
+  int nextMember();
+
+public:
+  ClientDecoder();
+  ~ClientDecoder();
+  /* Starts decoding the Content-Encoding value. Returns 1 if the body is
+   * decoded, 0 if it is passed through and -1 on error.
+   */
+  int begin(std::string_view contentEncoding);
+  bool isActive();
+  /* False if the encoded body ended early */
+  bool isDone();
+  int write(const char *data, std::size_t len, const decoderOutputType &);
+  /* Returns the inflate state to the free list of the calling thread */
+  int finish();
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_DECODER_H
@@ -0,0 +1,431 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// Local Project
+#include "ClientHttp2.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientHttp2Stream::ClientHttp2Stream() {
+  bodyOffset = 0;
+  refusedNum = 0;
+  streamId = 0;
+  cancelFlag = false;
+}
+ClientHttp2Stream::~ClientHttp2Stream() {}
+
+ClientHttp2Connection::ClientHttp2Connection(
+    boost::asio::io_context &ioContext)
+    : strand(ioContext.get_executor()) {
+  session = nullptr;
+  writeFlag = closeIdleFlag = false;
+  openFlag = false;
+  windowSize = 1 << 22;
+}
+
+ClientHttp2Connection::~ClientHttp2Connection() {
+  if (session) {
+    nghttp2_session_del(session);
+  }
+}
+
+int ClientHttp2Connection::start(
+    std::shared_ptr<ClientConnection> connectionPtr_) {
+  connectionPtr = connectionPtr_;
+  nghttp2_session_callbacks *callbacks;
+  nghttp2_session_callbacks_new(&callbacks);
+  nghttp2_session_callbacks_set_on_header_callback(
+      callbacks, &ClientHttp2Connection::onHeader);
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+      callbacks, &ClientHttp2Connection::onDataChunk);
+  nghttp2_session_callbacks_set_on_stream_close_callback(
+      callbacks, &ClientHttp2Connection::onStreamClose);
+  nghttp2_session_callbacks_set_on_frame_recv_callback(
+      callbacks, &ClientHttp2Connection::onFrame);
+  int rv = nghttp2_session_client_new(&session, callbacks, this);
+  nghttp2_session_callbacks_del(callbacks);
+  if (rv != 0) {
+    logStatus("::ClientHttp2Connection::start",
+              std::string("ERROR: ") + nghttp2_strerror(rv));
+    session = nullptr;
+    return -1;
+  }
+
+  nghttp2_settings_entry settingsList[] = {
+      {NGHTTP2_SETTINGS_ENABLE_PUSH, 0},
+      {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100},
+      {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE,
+       static_cast<uint32_t>(windowSize)}};
+  nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, settingsList,
+                          sizeof(settingsList) / sizeof(settingsList[0]));
+  // many streams share the connection window
+  nghttp2_session_set_local_window_size(
+      session, NGHTTP2_FLAG_NONE, 0,
+      static_cast<int32_t>(std::min<int64_t>(
+          static_cast<int64_t>(windowSize) * 16, NGHTTP2_MAX_WINDOW_SIZE)));
+  openFlag = true;
+
+  auto self = shared_from_this();
+  boost::asio::post(strand, [self]() {
+    self->doWrite();
+    self->doRead();
+  });
+  return 0;
+}
+
+bool ClientHttp2Connection::isOpen() { return openFlag; }
+
+std::shared_ptr<ClientHttp2Stream> ClientHttp2Connection::submit(
+    std::shared_ptr<
+        boost::beast::http::request<boost::beast::http::string_body>>
+        requestBeast,
+    std::shared_ptr<
+        boost::beast::http::response<boost::beast::http::string_body>>
+        responseBeast,
+    http2BodySourceType bodySource, http2BodyHandlerType bodyHandler,
+    http2HandlerType handler) {
+  auto streamPtr = std::make_shared<ClientHttp2Stream>();
+  streamPtr->requestBeast = requestBeast;
+  streamPtr->responseBeast = responseBeast;
+  streamPtr->bodySource = std::move(bodySource);
+  streamPtr->bodyHandler = std::move(bodyHandler);
+  streamPtr->handler = std::move(handler);
+  auto self = shared_from_this();
+  boost::asio::post(strand,
+                    [self, streamPtr]() { self->submitStream(streamPtr); });
+  return streamPtr;
+}
+
+void ClientHttp2Connection::cancel(
+    std::shared_ptr<ClientHttp2Stream> streamPtr) {
+  auto self = shared_from_this();
+  boost::asio::post(strand, [self, streamPtr]() {
+    streamPtr->cancelFlag = true;
+    auto it = self->streamMap.find(streamPtr->streamId);
+    if (it == self->streamMap.end() || it->second != streamPtr) {
+      // not opened yet, or already closed
+      return;
+    }
+    nghttp2_submit_rst_stream(self->session, NGHTTP2_FLAG_NONE,
+                              streamPtr->streamId, NGHTTP2_CANCEL);
+    self->doWrite();
+  });
+}
+
+void ClientHttp2Connection::closeWhenIdle() {
+  auto self = shared_from_this();
+  boost::asio::post(strand, [self]() {
+    self->closeIdleFlag = true;
+    if (self->streamMap.empty() && self->session) {
+      self->openFlag = false;
+      nghttp2_session_terminate_session(self->session, NGHTTP2_NO_ERROR);
+      self->doWrite();
+    }
+  });
+}
+
+void ClientHttp2Connection::submitStream(
+    std::shared_ptr<ClientHttp2Stream> streamPtr) {
+  if (streamPtr->cancelFlag) {
+    streamPtr->handler(-1);
+    return;
+  }
+  if (!openFlag) {
+    // never sent, the caller may send it on another connection
+    streamPtr->handler(1);
+    return;
+  }
+  auto &request = *streamPtr->requestBeast;
+  // nghttp2 copies the names and values before submit returns
+  std::vector<std::string> storageList;
+  storageList.reserve(
+      2 * (std::distance(request.begin(), request.end()) + 5));
+  std::vector<nghttp2_nv> nvList;
+  auto addHeader = [&](std::string name, std::string value) {
+    storageList.push_back(std::move(name));
+    std::string &nameStr = storageList.back();
+    storageList.push_back(std::move(value));
+    std::string &valueStr = storageList.back();
+    nvList.push_back({reinterpret_cast<uint8_t *>(nameStr.data()),
+                      reinterpret_cast<uint8_t *>(valueStr.data()),
+                      nameStr.size(), valueStr.size(), NGHTTP2_NV_FLAG_NONE});
+  };
+  addHeader(":method", std::string(request.method_string()));
+  addHeader(":scheme", "https");
+  addHeader(":authority",
+            std::string(request[boost::beast::http::field::host]));
+  addHeader(":path", std::string(request.target()));
+  for (auto const &field : request) {
+    std::string name(field.name_string());
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    // connection specific headers are not allowed in HTTP/2
+    if (name == "host" || name == "connection" || name == "keep-alive" ||
+        name == "proxy-connection" || name == "transfer-encoding" ||
+        name == "upgrade") {
+      continue;
+    }
+    addHeader(name, std::string(field.value()));
+  }
+  nghttp2_data_provider dataProvider;
+  dataProvider.source.ptr = streamPtr.get();
+  dataProvider.read_callback = &ClientHttp2Connection::readBody;
+  const bool bodyFlag = !request.body().empty() || streamPtr->bodySource;
+  if (bodyFlag && !streamPtr->bodySource &&
+      request.find(boost::beast::http::field::content_length) ==
+          request.end()) {
+    addHeader("content-length", std::to_string(request.body().size()));
+  }
+
+  int32_t streamId = nghttp2_submit_request(
+      session, nullptr, nvList.data(), nvList.size(),
+      bodyFlag ? &dataProvider : nullptr, streamPtr.get());
+  if (streamId < 0) {
+    logStatus("::ClientHttp2Connection::submit",
+              std::string("ERROR: ") + nghttp2_strerror(streamId));
+    streamPtr->handler(-1);
+    return;
+  }
+  streamPtr->streamId = streamId;
+  streamMap[streamId] = streamPtr;
+  doWrite();
+}
+
+void ClientHttp2Connection::doRead() {
+  auto self = shared_from_this();
+  connectionPtr->streamPtr->async_read_some(
+      boost::asio::buffer(readBuffer),
+      boost::asio::bind_executor(
+          strand, [self](boost::system::error_code ec, std::size_t len) {
+            if (ec) {
+              self->fail("async_read_some", ec);
+              return;
+            }
+            ssize_t rv = nghttp2_session_mem_recv(
+                self->session, self->readBuffer.data(), len);
+            if (rv < 0) {
+              self->fail(std::string("nghttp2_session_mem_recv ") +
+                             nghttp2_strerror(static_cast<int>(rv)),
+                         {});
+              return;
+            }
+            // settings acks and window updates
+            self->doWrite();
+            if (nghttp2_session_want_read(self->session) ||
+                nghttp2_session_want_write(self->session)) {
+              self->doRead();
+            } else {
+              self->fail("session finished", {});
+            }
+          }));
+}
+
+void ClientHttp2Connection::doWrite() {
+  if (writeFlag || !connectionPtr->streamPtr ||
+      !connectionPtr->streamPtr->isOpen()) {
+    return;
+  }
+  writeBuffer.clear();
+  for (;;) {
+    const uint8_t *data;
+    ssize_t len = nghttp2_session_mem_send(session, &data);
+    if (len < 0) {
+      fail(std::string("nghttp2_session_mem_send ") +
+               nghttp2_strerror(static_cast<int>(len)),
+           {});
+      return;
+    }
+    if (len == 0) {
+      break;
+    }
+    writeBuffer.insert(writeBuffer.end(), data, data + len);
+    if (writeBuffer.size() >= 65536) {
+      break;
+    }
+  }
+  if (writeBuffer.empty()) {
+    return;
+  }
+  writeFlag = true;
+  auto self = shared_from_this();
+  boost::asio::async_write(
+      *connectionPtr->streamPtr, boost::asio::buffer(writeBuffer),
+      boost::asio::bind_executor(
+          strand, [self](boost::system::error_code ec, std::size_t) {
+            self->writeFlag = false;
+            if (ec) {
+              self->fail("async_write", ec);
+              return;
+            }
+            self->doWrite();
+          }));
+}
+
+void ClientHttp2Connection::fail(std::string what,
+                                 boost::system::error_code ec) {
+  const bool wasOpen = openFlag.exchange(false);
+  std::unordered_map<int32_t, std::shared_ptr<ClientHttp2Stream>> failMap;
+  failMap.swap(streamMap);
+  if (!failMap.empty() || (wasOpen && ec)) {
+    logStatus("::ClientHttp2Connection::fail", what, ec);
+  }
+  for (auto &streamPair : failMap) {
+    streamPair.second->handler(-1);
+  }
+  /* Pending operations still reference the stream, so only the socket is
+   * closed here. The stream goes away with this object.
+   */
+  if (connectionPtr->streamPtr) {
+    connectionPtr->streamPtr->close();
+  }
+}
+
+int ClientHttp2Connection::onHeader(nghttp2_session *session,
+                                    const nghttp2_frame *frame,
+                                    const uint8_t *name, size_t nameLen,
+                                    const uint8_t *value, size_t valueLen,
+                                    uint8_t, void *) {
+  if (frame->hd.type != NGHTTP2_HEADERS) {
+    return 0;
+  }
+  auto *streamPtr = static_cast<ClientHttp2Stream *>(
+      nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+  if (!streamPtr) {
+    return 0;
+  }
+  boost::beast::string_view nameView(reinterpret_cast<const char *>(name),
+                                     nameLen);
+  boost::beast::string_view valueView(reinterpret_cast<const char *>(value),
+                                      valueLen);
+  if (nameView == ":status") {
+    // informational responses are replaced by the final one
+    streamPtr->responseBeast->result(
+        std::stoi(std::string(valueView.data(), valueView.size())));
+  } else if (!nameView.empty() && nameView[0] != ':') {
+    streamPtr->responseBeast->insert(nameView, valueView);
+  }
+  return 0;
+}
+
+int ClientHttp2Connection::onDataChunk(nghttp2_session *session, uint8_t,
+                                       int32_t streamId, const uint8_t *data,
+                                       size_t len, void *) {
+  auto *streamPtr = static_cast<ClientHttp2Stream *>(
+      nghttp2_session_get_stream_user_data(session, streamId));
+  if (!streamPtr) {
+    return 0;
+  }
+  if (streamPtr->bodyHandler(reinterpret_cast<const char *>(data), len) < 0) {
+    // the stream closes with CANCEL and fails
+    nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, streamId,
+                              NGHTTP2_CANCEL);
+    streamPtr->bodyHandler = [](const char *, std::size_t) { return 0; };
+  }
+  return 0;
+}
+
+int ClientHttp2Connection::onStreamClose(nghttp2_session *session,
+                                         int32_t streamId, uint32_t errorCode,
+                                         void *userData) {
+  auto *connection = static_cast<ClientHttp2Connection *>(userData);
+  auto it = connection->streamMap.find(streamId);
+  if (it == connection->streamMap.end()) {
+    return 0;
+  }
+  std::shared_ptr<ClientHttp2Stream> streamPtr = it->second;
+  connection->streamMap.erase(it);
+  /* The server refuses streams over its concurrency limit before its
+   * settings arrive. Those were not processed and can be sent again, unless
+   * part of a streamed body was already read from the source.
+   */
+  const bool refusedFlag =
+      errorCode == NGHTTP2_REFUSED_STREAM && !streamPtr->cancelFlag &&
+      (!streamPtr->bodySource || streamPtr->bodyOffset == 0);
+  if (refusedFlag && !connection->openFlag) {
+    /* Streams above the last stream id of a GOAWAY were not processed
+     * either, but this connection takes no new ones. The caller sends them
+     * on another connection.
+     */
+    streamPtr->responseBeast->version(20);
+    streamPtr->handler(1);
+    return 0;
+  }
+  if (refusedFlag && streamPtr->refusedNum < 3) {
+    streamPtr->refusedNum++;
+    streamPtr->bodyOffset = 0;
+    streamPtr->streamId = 0;
+    *streamPtr->responseBeast = {};
+    auto self = connection->shared_from_this();
+    boost::asio::post(connection->strand,
+                      [self, streamPtr]() { self->submitStream(streamPtr); });
+    return 0;
+  }
+  if (connection->closeIdleFlag && connection->streamMap.empty()) {
+    connection->openFlag = false;
+    nghttp2_session_terminate_session(session, NGHTTP2_NO_ERROR);
+  }
+  if (errorCode != NGHTTP2_NO_ERROR) {
+    logStatus("::ClientHttp2Connection::onStreamClose",
+              std::string("ERROR: stream reset, ") +
+                  nghttp2_http2_strerror(errorCode));
+  }
+  streamPtr->responseBeast->version(20);
+  streamPtr->handler(errorCode == NGHTTP2_NO_ERROR ? 0 : -1);
+  return 0;
+}
+
+int ClientHttp2Connection::onFrame(nghttp2_session *,
+                                   const nghttp2_frame *frame,
+                                   void *userData) {
+  auto *connection = static_cast<ClientHttp2Connection *>(userData);
+  if (frame->hd.type == NGHTTP2_GOAWAY) {
+    // streams already open finish, new requests open another connection
+    connection->openFlag = false;
+  }
+  return 0;
+}
+
+ssize_t ClientHttp2Connection::readBody(nghttp2_session *, int32_t,
+                                        uint8_t *buf, size_t length,
+                                        uint32_t *dataFlags,
+                                        nghttp2_data_source *source, void *) {
+  auto *streamPtr = static_cast<ClientHttp2Stream *>(source->ptr);
+  if (streamPtr->bodySource) {
+    std::int64_t len =
+        streamPtr->bodySource(reinterpret_cast<char *>(buf), length);
+    if (len < 0) {
+      // resets the stream
+      return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+    if (len == 0) {
+      *dataFlags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    streamPtr->bodyOffset += len;
+    return static_cast<ssize_t>(len);
+  }
+  const std::string &body = streamPtr->requestBeast->body();
+  std::size_t len = std::min(length, body.size() - streamPtr->bodyOffset);
+  std::memcpy(buf, body.data() + streamPtr->bodyOffset, len);
+  streamPtr->bodyOffset += len;
+  if (streamPtr->bodyOffset == body.size()) {
+    *dataFlags |= NGHTTP2_DATA_FLAG_EOF;
+  }
+  return static_cast<ssize_t>(len);
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,157 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_HTTP2_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_HTTP2_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/http/string_body.hpp>
+
+/* nghttp2 1.40+
+ * License: MIT
+ */
+#include <nghttp2/nghttp2.h>
+
+// Local Project
+#include "ClientPool.hpp"
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* called with the result code once the stream closed, 1 if the request was
+ * not processed because the connection is going away
+ */
+using http2HandlerType = std::function<void(int)>;
+// called with each chunk of the body, -1 resets the stream
+using http2BodyHandlerType = std::function<int(const char *, std::size_t)>;
+// fills the buffer with the request body, 0 at the end and -1 on error
+using http2BodySourceType = std::function<std::int64_t(char *, std::size_t)>;
+
+class ClientHttp2Stream {
+public:
+  ClientHttp2Stream();
+  ~ClientHttp2Stream();
+  std::shared_ptr<
+      boost::beast::http::request<boost::beast::http::string_body>>
+      requestBeast;
+  std::shared_ptr<
+      boost::beast::http::response<boost::beast::http::string_body>>
+      responseBeast;
+  // bytes of the request body already handed to nghttp2
+  std::size_t bodyOffset;
+  // streams the request body instead of requestBeast->body()
+  http2BodySourceType bodySource;
+  // times the server refused the stream before processing it
+  int refusedNum;
+  // 0 until the stream was opened
+  int32_t streamId;
+  bool cancelFlag;
+  http2BodyHandlerType bodyHandler;
+  http2HandlerType handler;
+};
+
+/* One TLS connection that negotiated h2 through ALPN. Requests from every
+ * client to the same host are multiplexed over it as streams. nghttp2 does
+ * the framing, HPACK and flow control. All session calls run on the strand.
+ */
+class ClientHttp2Connection
+    : public std::enable_shared_from_this<ClientHttp2Connection> {
+private:
+  boost::asio::strand<boost::asio::io_context::executor_type> strand;
+  std::shared_ptr<ClientConnection> connectionPtr;
+  nghttp2_session *session;
+  // open streams by stream id
+  std::unordered_map<int32_t, std::shared_ptr<ClientHttp2Stream>> streamMap;
+  std::array<uint8_t, 16384> readBuffer;
+  std::vector<uint8_t> writeBuffer;
+  bool writeFlag, closeIdleFlag;
+  std::atomic<bool> openFlag;
+  /* Opens a stream for the request. Runs on the strand. */
+  void submitStream(std::shared_ptr<ClientHttp2Stream>);
+  void doRead();
+  /* Sends everything nghttp2 has queued, one write at a time */
+  void doWrite();
+  /* Fails every open stream and closes the socket */
+  void fail(std::string what, boost::system::error_code ec);
+  static int onHeader(nghttp2_session *, const nghttp2_frame *,
+                      const uint8_t *name, size_t nameLen,
+                      const uint8_t *value, size_t valueLen, uint8_t flags,
+                      void *userData);
+  static int onDataChunk(nghttp2_session *, uint8_t flags, int32_t streamId,
+                         const uint8_t *data, size_t len, void *userData);
+  static int onStreamClose(nghttp2_session *, int32_t streamId,
+                           uint32_t errorCode, void *userData);
+  static int onFrame(nghttp2_session *, const nghttp2_frame *,
+                     void *userData);
+  static ssize_t readBody(nghttp2_session *, int32_t streamId, uint8_t *buf,
+                          size_t length, uint32_t *dataFlags,
+                          nghttp2_data_source *, void *userData);
+
+public:
+  ClientHttp2Connection(boost::asio::io_context &);
+  ~ClientHttp2Connection();
+  // receive window of each stream, the connection window is 16 times larger
+  int32_t windowSize;
+  /* Takes over a connection whose handshake selected h2 and sends the
+   * connection preface
+   */
+  int start(std::shared_ptr<ClientConnection>);
+  /* False once the socket failed or the server sent GOAWAY */
+  bool isOpen();
+  /* Sends GOAWAY once the open streams finished. Used for connections that
+   * lost the race to become the shared connection to a host.
+   */
+  void closeWhenIdle();
+  /* Queues the request as a new stream. The request body is read from the
+   * body source if there is one. Response body chunks go to the body handler.
+   * The handler is called on the strand once the response is complete, with
+   * -1 if the stream failed and with 1 if the server refused it at GOAWAY or
+   * the connection closed before it was sent. Those requests can be sent
+   * again on a new connection.
+   */
+  std::shared_ptr<ClientHttp2Stream>
+  submit(std::shared_ptr<
+                  boost::beast::http::request<boost::beast::http::string_body>>
+                  requestBeast,
+              std::shared_ptr<
+                  boost::beast::http::response<boost::beast::http::string_body>>
+                  responseBeast,
+              http2BodySourceType bodySource, http2BodyHandlerType bodyHandler,
+              http2HandlerType handler);
+  /* Resets the stream with CANCEL. Its handler is called with -1. */
+  void cancel(std::shared_ptr<ClientHttp2Stream>);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_HTTP2_H
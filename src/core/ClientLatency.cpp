@@ -0,0 +1,55 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientLatency.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientLatency::ClientLatency() {
+  sampleMax = 128;
+  sampleMin = 16;
+}
+
+ClientLatency::~ClientLatency() {}
+
+void ClientLatency::add(const std::string &key,
+                        std::chrono::milliseconds latency) {
+  const std::lock_guard<std::mutex> lock(latencyMutex);
+  auto &sampleList = sampleMap[key];
+  sampleList.push_back(latency);
+  while (sampleList.size() > sampleMax) {
+    sampleList.pop_front();
+  }
+}
+
+std::optional<std::chrono::milliseconds>
+ClientLatency::percentile(const std::string &key, int percent) {
+  std::vector<std::chrono::milliseconds> sortList;
+  {
+    const std::lock_guard<std::mutex> lock(latencyMutex);
+    auto it = sampleMap.find(key);
+    if (it == sampleMap.end() || it->second.size() < sampleMin) {
+      return std::nullopt;
+    }
+    sortList.assign(it->second.begin(), it->second.end());
+  }
+  std::size_t index = std::min(sortList.size() - 1,
+                               sortList.size() * std::clamp(percent, 0, 100) /
+                                   100);
+  std::nth_element(sortList.begin(), sortList.begin() + index,
+                   sortList.end());
+  return sortList[index];
+}
+
+} // namespace HTTP
+} // namespace bookfiler
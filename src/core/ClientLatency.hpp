@@ -0,0 +1,56 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_LATENCY_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_LATENCY_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Latencies of the last sampleMax successful requests to each
+ * "scheme://host:port". Used to pick the delay before a hedged request.
+ */
+class ClientLatency {
+private:
+  std::mutex latencyMutex;
+  std::unordered_map<std::string, std::deque<std::chrono::milliseconds>>
+      sampleMap;
+
+public:
+  ClientLatency();
+  ~ClientLatency();
+  std::size_t sampleMax, sampleMin;
+  void add(const std::string &key, std::chrono::milliseconds latency);
+  /* The percentile, 0 to 100, of the samples of the key. Empty until there
+   * are sampleMin samples.
+   */
+  std::optional<std::chrono::milliseconds> percentile(const std::string &key,
+                                                      int percent);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_LATENCY_H
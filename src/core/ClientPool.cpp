@@ -0,0 +1,422 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <algorithm>
+
+// Local Project
+#include "ClientPool.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientConnection::ClientConnection() {
+  requestNum = 0;
+  http2Flag = false;
+}
+ClientConnection::~ClientConnection() { close(); }
+
+int ClientConnection::healthCheck() {
+  if (!streamPtr) {
+    return -1;
+  }
+  return streamPtr->peekIdle();
+}
+
+void ClientConnection::close() {
+  if (!streamPtr) {
+    return;
+  }
+  streamPtr->close();
+  streamPtr.reset();
+}
+
+ClientPoolWaiter::ClientPoolWaiter(boost::asio::io_context &ioContext)
+    : timer(ioContext) {}
+ClientPoolWaiter::~ClientPoolWaiter() {}
+
+ClientPoolLimit::ClientPoolLimit() {
+  limit = 1.0;
+  noLoadRtt = lastRtt = 0.0;
+  sampleNum = dropNum = 0;
+}
+ClientPoolLimit::~ClientPoolLimit() {}
+
+ClientPoolSettings::ClientPoolSettings() {
+  maxPerHost = 8;
+  adaptiveFlag = false;
+  minPerHost = 1;
+  limitTolerance = 1.5;
+  idleTimeout = std::chrono::seconds(60);
+  acquireTimeout = std::chrono::seconds(30);
+}
+ClientPoolSettings::~ClientPoolSettings() {}
+
+ClientPool::ClientPool(boost::asio::io_context &ioContext_)
+    : ioContext(ioContext_) {
+  hitNum = missNum = healthCheckFailNum = evictNum = waitNum = 0;
+}
+ClientPool::~ClientPool() {}
+
+ClientPoolSettings ClientPool::getSettings() {
+  const std::lock_guard<std::mutex> lock(poolMutex);
+  return settings;
+}
+
+void ClientPool::setSettings(const ClientPoolSettings &settings_) {
+  std::vector<std::function<void()>> grantList;
+  {
+    const std::lock_guard<std::mutex> lock(poolMutex);
+    settings = settings_;
+    // a raised limit frees slots for the queued waiters
+    for (auto &waiterPair : waiterMap) {
+      auto keyGrantList = grantWaiters(waiterPair.first);
+      grantList.insert(grantList.end(), keyGrantList.begin(),
+                       keyGrantList.end());
+    }
+  }
+  for (auto &grant : grantList) {
+    grant();
+  }
+  poolCondition.notify_all();
+}
+
+void ClientPool::evictIdle(std::chrono::steady_clock::time_point now) {
+  for (auto &idlePair : idleMap) {
+    // the front of each list holds the least recently used connection
+    auto &idleList = idlePair.second;
+    while (!idleList.empty() &&
+           now - idleList.front()->lastUsed > settings.idleTimeout) {
+      idleList.front()->close();
+      idleList.pop_front();
+      evictNum++;
+    }
+  }
+}
+
+std::shared_ptr<ClientConnection> ClientPool::takeIdle(
+    std::deque<std::shared_ptr<ClientConnection>> &idleList) {
+  // reuse the most recently used connection first since it is the least
+  // likely to have been closed by the server
+  while (!idleList.empty()) {
+    std::shared_ptr<ClientConnection> idlePtr = idleList.back();
+    idleList.pop_back();
+    if (idlePtr->healthCheck() == 0) {
+      return idlePtr;
+    }
+    healthCheckFailNum++;
+    idlePtr->close();
+  }
+  return nullptr;
+}
+
+int ClientPool::getLimit(const std::string &key) {
+  if (!settings.adaptiveFlag) {
+    return settings.maxPerHost;
+  }
+  auto it = limitMap.find(key);
+  if (it == limitMap.end()) {
+    return settings.maxPerHost;
+  }
+  return std::clamp(
+      static_cast<int>(it->second.limit),
+      std::max(1, std::min(settings.minPerHost, settings.maxPerHost)),
+      settings.maxPerHost);
+}
+
+std::vector<std::function<void()>>
+ClientPool::grantWaiters(const std::string &key) {
+  std::vector<std::function<void()>> grantList;
+  auto waiterIt = waiterMap.find(key);
+  if (waiterIt == waiterMap.end()) {
+    return grantList;
+  }
+  auto &waiterList = waiterIt->second;
+  int &activeNum = activeMap[key];
+  while (!waiterList.empty() && activeNum < getLimit(key)) {
+    std::shared_ptr<ClientPoolWaiter> waiterPtr = waiterList.front();
+    waiterList.pop_front();
+    waiterPtr->timer.cancel();
+    std::shared_ptr<ClientConnection> connectionPtr = takeIdle(idleMap[key]);
+    activeNum++;
+    if (connectionPtr) {
+      hitNum++;
+    } else {
+      missNum++;
+    }
+    acquireHandlerType waiterHandler;
+    waiterHandler.swap(waiterPtr->handler);
+    grantList.push_back([waiterHandler, connectionPtr]() {
+      waiterHandler(0, connectionPtr);
+    });
+  }
+  return grantList;
+}
+
+int ClientPool::acquire(const std::string &key,
+                        std::shared_ptr<ClientConnection> &connectionPtr) {
+  std::unique_lock<std::mutex> lock(poolMutex);
+  evictIdle(std::chrono::steady_clock::now());
+  auto &idleList = idleMap[key];
+  int &activeNum = activeMap[key];
+  bool waited = false;
+  for (;;) {
+    // idle connections over a shrunk limit stay unused until they expire
+    if (activeNum < getLimit(key)) {
+      connectionPtr = takeIdle(idleList);
+      activeNum++;
+      if (connectionPtr) {
+        hitNum++;
+      } else {
+        missNum++;
+      }
+      return 0;
+    }
+    if (!waited) {
+      waitNum++;
+      waited = true;
+    }
+    int &blockedNum = blockedMap[key];
+    blockedNum++;
+    const bool slotFlag =
+        poolCondition.wait_for(lock, settings.acquireTimeout,
+                               [&] { return activeNum < getLimit(key); });
+    blockedNum--;
+    if (!slotFlag) {
+      logStatus("::ClientPool::acquire",
+                "ERROR: timed out waiting for a connection to " + key);
+      return -1;
+    }
+  }
+}
+
+void ClientPool::asyncAcquire(const std::string &key,
+                              acquireHandlerType handler) {
+  asyncAcquire(
+      key,
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          getSettings().acquireTimeout),
+      std::move(handler));
+}
+
+std::shared_ptr<ClientPoolWaiter>
+ClientPool::asyncAcquire(const std::string &key,
+                         std::chrono::milliseconds timeout,
+                         acquireHandlerType handler) {
+  std::shared_ptr<ClientConnection> connectionPtr;
+  {
+    const std::lock_guard<std::mutex> lock(poolMutex);
+    evictIdle(std::chrono::steady_clock::now());
+    int &activeNum = activeMap[key];
+    if (activeNum < getLimit(key)) {
+      connectionPtr = takeIdle(idleMap[key]);
+      activeNum++;
+      if (connectionPtr) {
+        hitNum++;
+      } else {
+        missNum++;
+      }
+    } else {
+      waitNum++;
+      auto waiterPtr = std::make_shared<ClientPoolWaiter>(ioContext);
+      waiterPtr->handler = std::move(handler);
+      waiterPtr->timer.expires_after(timeout);
+      waiterPtr->timer.async_wait(
+          [this, key, waiterPtr](boost::system::error_code ec) {
+            acquireHandlerType timeoutHandler;
+            {
+              const std::lock_guard<std::mutex> lock(poolMutex);
+              auto &waiterList = waiterMap[key];
+              auto it =
+                  std::find(waiterList.begin(), waiterList.end(), waiterPtr);
+              if (it == waiterList.end()) {
+                // release already handed this waiter a slot
+                return;
+              }
+              waiterList.erase(it);
+              timeoutHandler.swap(waiterPtr->handler);
+            }
+            if (ec != boost::asio::error::operation_aborted) {
+              logStatus("::ClientPool::asyncAcquire",
+                        "ERROR: timed out waiting for a connection to " + key);
+            }
+            timeoutHandler(-1, nullptr);
+          });
+      waiterMap[key].push_back(waiterPtr);
+      return waiterPtr;
+    }
+  }
+  handler(0, connectionPtr);
+  return nullptr;
+}
+
+void ClientPool::cancelAcquire(std::shared_ptr<ClientPoolWaiter> waiterPtr) {
+  const std::lock_guard<std::mutex> lock(poolMutex);
+  // the timer handler sees the waiter is still queued and fails it
+  waiterPtr->timer.cancel();
+}
+
+int ClientPool::release(const std::string &key,
+                        std::shared_ptr<ClientConnection> connectionPtr,
+                        bool reusable) {
+  std::shared_ptr<ClientPoolWaiter> waiterPtr;
+  acquireHandlerType waiterHandler;
+  {
+    const std::lock_guard<std::mutex> lock(poolMutex);
+    const bool keep = reusable && connectionPtr && connectionPtr->streamPtr &&
+                      connectionPtr->streamPtr->isOpen();
+    if (keep) {
+      connectionPtr->lastUsed = std::chrono::steady_clock::now();
+      connectionPtr->requestNum++;
+    } else if (connectionPtr) {
+      connectionPtr->close();
+      connectionPtr.reset();
+    }
+    auto &waiterList = waiterMap[key];
+    int &activeNum = activeMap[key];
+    if (!waiterList.empty() && activeNum <= getLimit(key)) {
+      // the slot moves straight to the oldest waiter so activeMap is unchanged
+      waiterPtr = waiterList.front();
+      waiterList.pop_front();
+      waiterPtr->timer.cancel();
+      waiterHandler.swap(waiterPtr->handler);
+      if (connectionPtr) {
+        hitNum++;
+      } else {
+        missNum++;
+      }
+    } else {
+      // over a shrunk limit the slot is dropped instead of handed on
+      activeNum--;
+      if (connectionPtr) {
+        idleMap[key].push_back(connectionPtr);
+      }
+    }
+  }
+  if (waiterHandler) {
+    waiterHandler(0, connectionPtr);
+    return 0;
+  }
+  poolCondition.notify_one();
+  return 0;
+}
+
+void ClientPool::addSample(const std::string &key,
+                           std::chrono::microseconds latency, bool dropFlag) {
+  std::vector<std::function<void()>> grantList;
+  {
+    const std::lock_guard<std::mutex> lock(poolMutex);
+    if (!settings.adaptiveFlag) {
+      return;
+    }
+    auto it = limitMap.find(key);
+    if (it == limitMap.end()) {
+      it = limitMap.emplace(key, ClientPoolLimit()).first;
+      it->second.limit = settings.maxPerHost;
+    }
+    ClientPoolLimit &limitState = it->second;
+    const double lowerBound =
+        std::max(1, std::min(settings.minPerHost, settings.maxPerHost));
+    const double upperBound = settings.maxPerHost;
+    if (dropFlag) {
+      limitState.dropNum++;
+      limitState.limit *= 0.9;
+    } else {
+      const double rtt = std::max(0.001, latency.count() / 1000.0);
+      limitState.lastRtt = rtt;
+      limitState.sampleNum++;
+      /* The no-load latency follows a new minimum at once and otherwise
+       * drifts up over about 600 samples, so a lasting change of the
+       * upstream is learned but queueing is not
+       */
+      if (limitState.sampleNum == 1 || rtt < limitState.noLoadRtt) {
+        limitState.noLoadRtt = rtt;
+      } else {
+        limitState.noLoadRtt += (rtt - limitState.noLoadRtt) / 600.0;
+      }
+      /* A key using less than half of its slots says nothing about the
+       * capacity of the server
+       */
+      if (activeMap[key] >= limitState.limit / 2) {
+        const double gradient = std::clamp(
+            settings.limitTolerance * limitState.noLoadRtt / rtt, 0.5, 1.0);
+        // the square root allows a small queue at the server
+        const double newLimit =
+            limitState.limit * gradient + std::sqrt(limitState.limit);
+        limitState.limit = limitState.limit * 0.8 + newLimit * 0.2;
+      }
+    }
+    limitState.limit = std::clamp(limitState.limit, lowerBound, upperBound);
+    grantList = grantWaiters(key);
+  }
+  for (auto &grant : grantList) {
+    grant();
+  }
+  poolCondition.notify_all();
+}
+
+int ClientPool::getStats(rapidjson::Value &statsValue,
+                         rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(poolMutex);
+  uint64_t idleNum = 0, activeNum = 0;
+  for (auto &idlePair : idleMap) {
+    idleNum += idlePair.second.size();
+  }
+  for (auto &activePair : activeMap) {
+    activeNum += activePair.second;
+  }
+  uint64_t requestNum = hitNum + missNum;
+  double hitRate =
+      requestNum ? static_cast<double>(hitNum) / requestNum : 0.0;
+  statsValue.SetObject();
+  statsValue.AddMember("hits", hitNum, allocator);
+  statsValue.AddMember("misses", missNum, allocator);
+  statsValue.AddMember("hitRate", hitRate, allocator);
+  statsValue.AddMember("healthCheckFailures", healthCheckFailNum, allocator);
+  statsValue.AddMember("idleEvictions", evictNum, allocator);
+  statsValue.AddMember("waits", waitNum, allocator);
+  statsValue.AddMember("idleConnections", idleNum, allocator);
+  statsValue.AddMember("activeConnections", activeNum, allocator);
+  // queue depth and current limit of every key
+  uint64_t queuedNum = 0;
+  rapidjson::Value hostsValue;
+  hostsValue.SetObject();
+  for (auto &activePair : activeMap) {
+    const std::string &key = activePair.first;
+    rapidjson::Value hostValue;
+    hostValue.SetObject();
+    uint64_t hostQueuedNum = blockedMap.count(key) ? blockedMap[key] : 0;
+    auto waiterIt = waiterMap.find(key);
+    if (waiterIt != waiterMap.end()) {
+      hostQueuedNum += waiterIt->second.size();
+    }
+    queuedNum += hostQueuedNum;
+    hostValue.AddMember("limit", getLimit(key), allocator);
+    hostValue.AddMember("active", activePair.second, allocator);
+    hostValue.AddMember("queued", hostQueuedNum, allocator);
+    auto limitIt = limitMap.find(key);
+    if (limitIt != limitMap.end()) {
+      hostValue.AddMember("latency", limitIt->second.lastRtt, allocator);
+      hostValue.AddMember("noLoadLatency", limitIt->second.noLoadRtt,
+                          allocator);
+      hostValue.AddMember("samples", limitIt->second.sampleNum, allocator);
+      hostValue.AddMember("drops", limitIt->second.dropNum, allocator);
+    }
+    hostsValue.AddMember(rapidjson::Value(key.c_str(), allocator), hostValue,
+                         allocator);
+  }
+  statsValue.AddMember("queued", queuedNum, allocator);
+  statsValue.AddMember("hosts", hostsValue, allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
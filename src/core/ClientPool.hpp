@@ -0,0 +1,205 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_POOL_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_POOL_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// Local Project
+#include "ClientStream.hpp"
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* A keep-alive connection owned by the pool while idle and by a single
+ * ClientImpl while a request is in flight.
+ */
+class ClientConnection {
+public:
+  ClientConnection();
+  ~ClientConnection();
+  // declared before the stream so they outlive it
+  std::shared_ptr<boost::asio::ssl::context> sslContextPtr;
+  std::string sessionKey;
+  std::unique_ptr<ClientStream> streamPtr;
+  std::chrono::steady_clock::time_point lastUsed;
+  unsigned int requestNum;
+  // the handshake selected h2 through ALPN
+  bool http2Flag;
+  /* Returns 0 if the socket is still open and the peer has neither closed it
+   * nor sent unsolicited data. Does not block.
+   */
+  int healthCheck();
+  void close();
+};
+
+using acquireHandlerType =
+    std::function<void(int, std::shared_ptr<ClientConnection>)>;
+
+/* An asynchronous acquire waiting for a slot. The timer and handler are only
+ * touched while the pool mutex is held.
+ */
+class ClientPoolWaiter {
+public:
+  ClientPoolWaiter(boost::asio::io_context &);
+  ~ClientPoolWaiter();
+  acquireHandlerType handler;
+  boost::asio::steady_timer timer;
+};
+
+/* Adaptive concurrency limit of one key. The limit follows the gradient
+ * between the no-load and the latest request latency: it grows while
+ * latency stays near the no-load latency and shrinks once requests queue
+ * up at the server. Errors cut it multiplicatively.
+ */
+class ClientPoolLimit {
+public:
+  ClientPoolLimit();
+  ~ClientPoolLimit();
+  double limit;
+  // milliseconds
+  double noLoadRtt, lastRtt;
+  uint64_t sampleNum, dropNum;
+};
+
+/* Limits of the pool, replaced as a whole when the settings are pushed */
+class ClientPoolSettings {
+public:
+  ClientPoolSettings();
+  ~ClientPoolSettings();
+  int maxPerHost;
+  /* Adjusts the limit of each key between minPerHost and maxPerHost from
+   * the samples. Otherwise every key may use maxPerHost slots.
+   */
+  bool adaptiveFlag;
+  int minPerHost;
+  // latency growth over the no-load latency tolerated before the limit
+  // shrinks
+  double limitTolerance;
+  std::chrono::seconds idleTimeout;
+  std::chrono::seconds acquireTimeout;
+};
+
+/* Keep-alive connection pool keyed by "scheme://host:port".
+ * Shared by every client created from the same module.
+ */
+class ClientPool {
+private:
+  boost::asio::io_context &ioContext;
+  std::mutex poolMutex;
+  std::condition_variable poolCondition;
+  std::unordered_map<std::string,
+                     std::deque<std::shared_ptr<ClientConnection>>>
+      idleMap;
+  // connections handed out or being established per key
+  std::unordered_map<std::string, int> activeMap;
+  // asynchronous acquires waiting per key, oldest first
+  std::unordered_map<std::string,
+                     std::deque<std::shared_ptr<ClientPoolWaiter>>>
+      waiterMap;
+  // blocking acquires waiting per key
+  std::unordered_map<std::string, int> blockedMap;
+  std::unordered_map<std::string, ClientPoolLimit> limitMap;
+  // guarded by poolMutex
+  ClientPoolSettings settings;
+  // statistics
+  uint64_t hitNum, missNum, healthCheckFailNum, evictNum, waitNum;
+  void evictIdle(std::chrono::steady_clock::time_point now);
+  /* Pops idle connections until a healthy one is found. poolMutex must be
+   * held.
+   */
+  std::shared_ptr<ClientConnection>
+  takeIdle(std::deque<std::shared_ptr<ClientConnection>> &idleList);
+  /* Slots the key may use at once. poolMutex must be held. */
+  int getLimit(const std::string &key);
+  /* Hands free slots below the limit to the oldest waiters. poolMutex must
+   * be held. The returned calls run the handlers after it is released.
+   */
+  std::vector<std::function<void()>> grantWaiters(const std::string &key);
+
+public:
+  ClientPool(boost::asio::io_context &);
+  ~ClientPool();
+  ClientPoolSettings getSettings();
+  void setSettings(const ClientPoolSettings &);
+  /* Reserves a slot for the key and returns a healthy idle connection if one
+   * exists. A null connection with rc = 0 means the caller must open a new
+   * connection in the reserved slot. Returns -1 if no slot freed up within
+   * acquireTimeout.
+   */
+  int acquire(const std::string &key,
+              std::shared_ptr<ClientConnection> &connectionPtr);
+  /* Same as acquire but never blocks. The handler is called inline if a slot
+   * is free, otherwise from the thread releasing a slot or from the
+   * io_context when acquireTimeout expires.
+   */
+  void asyncAcquire(const std::string &key, acquireHandlerType handler);
+  /* Waits at most timeout instead of acquireTimeout. Returns the waiter if
+   * the request was queued, for cancelAcquire.
+   */
+  std::shared_ptr<ClientPoolWaiter>
+  asyncAcquire(const std::string &key, std::chrono::milliseconds timeout,
+               acquireHandlerType handler);
+  /* Calls the waiter's handler with -1 unless it was handed a slot */
+  void cancelAcquire(std::shared_ptr<ClientPoolWaiter>);
+  /* Gives the slot back. The connection is kept for reuse only if reusable
+   * is true and the socket is still open. Asynchronous waiters are handed
+   * the slot before blocked acquire calls are woken.
+   */
+  int release(const std::string &key,
+              std::shared_ptr<ClientConnection> connectionPtr, bool reusable);
+  /* Feeds the adaptive limit with the latency of a request sent on a slot
+   * of the key. dropFlag marks requests that failed or that the server
+   * rejected as overloaded. The latency must not include the time spent
+   * waiting for the slot or opening the connection.
+   */
+  void addSample(const std::string &key, std::chrono::microseconds latency,
+                 bool dropFlag);
+  int getStats(rapidjson::Value &,
+               rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_POOL_H
@@ -0,0 +1,204 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <future>
+
+// Local Project
+#include "ClientResolver.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientResolverEntry::ClientResolverEntry() {
+  resolvedFlag = inFlightFlag = false;
+}
+ClientResolverEntry::~ClientResolverEntry() {}
+
+ClientResolverSettings::ClientResolverSettings() {
+  ttl = std::chrono::seconds(60);
+  staleTtl = std::chrono::seconds(300);
+  negativeTtl = std::chrono::seconds(5);
+}
+ClientResolverSettings::~ClientResolverSettings() {}
+
+ClientResolver::ClientResolver(boost::asio::io_context &ioContext_)
+    : ioContext(ioContext_) {
+  maxEntries = 4096;
+  hitNum = staleHitNum = missNum = negativeHitNum = lookupNum = 0;
+}
+ClientResolver::~ClientResolver() {}
+
+void ClientResolver::setSettings(const ClientResolverSettings &settings_) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  settings = settings_;
+}
+
+void ClientResolver::asyncResolve(std::string host, std::string port,
+                                  resolveHandlerType handler) {
+  const std::string key = host + ":" + port;
+  boost::asio::ip::tcp::resolver::results_type results;
+  boost::system::error_code ec;
+  {
+    const std::lock_guard<std::mutex> lock(cacheMutex);
+    auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<ClientResolverEntry> &entryPtr = cacheMap[key];
+    if (!entryPtr) {
+      evict(now);
+      entryPtr = std::make_shared<ClientResolverEntry>();
+    }
+    if (entryPtr->resolvedFlag && now < entryPtr->expireTime) {
+      if (entryPtr->ec) {
+        negativeHitNum++;
+      } else {
+        hitNum++;
+      }
+    } else if (entryPtr->resolvedFlag && !entryPtr->ec &&
+               now < entryPtr->staleTime) {
+      // serve the old addresses and refresh in the background
+      staleHitNum++;
+      if (!entryPtr->inFlightFlag) {
+        startLookup(entryPtr, host, port);
+      }
+    } else {
+      missNum++;
+      entryPtr->handlerList.push_back(std::move(handler));
+      if (!entryPtr->inFlightFlag) {
+        startLookup(entryPtr, host, port);
+      }
+      return;
+    }
+    results = entryPtr->results;
+    ec = entryPtr->ec;
+  }
+  handler(ec, results);
+}
+
+void ClientResolver::startLookup(std::shared_ptr<ClientResolverEntry> entryPtr,
+                                 std::string host, std::string port) {
+  entryPtr->inFlightFlag = true;
+  lookupNum++;
+  auto resolverPtr =
+      std::make_shared<boost::asio::ip::tcp::resolver>(ioContext);
+  resolverPtr->async_resolve(
+      host, port,
+      [this, entryPtr, resolverPtr,
+       host](boost::system::error_code ec,
+             boost::asio::ip::tcp::resolver::results_type results) {
+        std::vector<resolveHandlerType> handlerList;
+        {
+          const std::lock_guard<std::mutex> lock(cacheMutex);
+          auto now = std::chrono::steady_clock::now();
+          if (ec && entryPtr->resolvedFlag && !entryPtr->ec &&
+              now < entryPtr->staleTime) {
+            // keep serving the stale addresses and try again later
+            logStatus("::ClientResolver::startLookup",
+                      "refresh failed for " + host, ec);
+            entryPtr->expireTime = now + settings.negativeTtl;
+          } else {
+            entryPtr->results = results;
+            entryPtr->ec = ec;
+            entryPtr->resolvedFlag = true;
+            if (ec) {
+              entryPtr->expireTime = entryPtr->staleTime =
+                  now + settings.negativeTtl;
+            } else {
+              entryPtr->expireTime = now + settings.ttl;
+              entryPtr->staleTime =
+                  entryPtr->expireTime + settings.staleTtl;
+            }
+          }
+          entryPtr->inFlightFlag = false;
+          handlerList.swap(entryPtr->handlerList);
+          results = entryPtr->results;
+          ec = entryPtr->ec;
+        }
+        for (auto &handler : handlerList) {
+          handler(ec, results);
+        }
+      });
+}
+
+void ClientResolver::evict(std::chrono::steady_clock::time_point now) {
+  if (cacheMap.size() < maxEntries) {
+    return;
+  }
+  for (auto it = cacheMap.begin(); it != cacheMap.end();) {
+    if (it->second && !it->second->inFlightFlag &&
+        now >= it->second->staleTime) {
+      it = cacheMap.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (cacheMap.size() <= maxEntries) {
+    return;
+  }
+  // still full of fresh hosts, drop those that expire first
+  std::vector<std::pair<std::chrono::steady_clock::time_point, std::string>>
+      candidateList;
+  for (auto &entryPair : cacheMap) {
+    if (entryPair.second && !entryPair.second->inFlightFlag) {
+      candidateList.emplace_back(entryPair.second->staleTime, entryPair.first);
+    }
+  }
+  std::size_t dropNum =
+      std::min(cacheMap.size() - maxEntries, candidateList.size());
+  std::nth_element(candidateList.begin(), candidateList.begin() + dropNum,
+                   candidateList.end());
+  for (std::size_t i = 0; i < dropNum; i++) {
+    cacheMap.erase(candidateList[i].second);
+  }
+}
+
+int ClientResolver::resolve(
+    std::string host, std::string port,
+    boost::asio::ip::tcp::resolver::results_type &results,
+    boost::system::error_code &ec, bool waitFlag) {
+  if (!waitFlag) {
+    // nothing may complete the lookup while this thread waits
+    {
+      const std::lock_guard<std::mutex> lock(cacheMutex);
+      lookupNum++;
+    }
+    boost::asio::ip::tcp::resolver resolver(ioContext);
+    results = resolver.resolve(host, port, ec);
+    return ec ? -1 : 0;
+  }
+  std::promise<void> resolvePromise;
+  std::future<void> resolveFuture = resolvePromise.get_future();
+  asyncResolve(host, port,
+               [&](boost::system::error_code ec_,
+                   boost::asio::ip::tcp::resolver::results_type results_) {
+                 ec = ec_;
+                 results = results_;
+                 resolvePromise.set_value();
+               });
+  resolveFuture.wait();
+  return ec ? -1 : 0;
+}
+
+int ClientResolver::getStats(rapidjson::Value &statsValue,
+                             rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  statsValue.SetObject();
+  statsValue.AddMember("hits", hitNum, allocator);
+  statsValue.AddMember("staleHits", staleHitNum, allocator);
+  statsValue.AddMember("negativeHits", negativeHitNum, allocator);
+  statsValue.AddMember("misses", missNum, allocator);
+  statsValue.AddMember("lookups", lookupNum, allocator);
+  statsValue.AddMember("entries", static_cast<uint64_t>(cacheMap.size()),
+                       allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,118 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RESOLVER_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RESOLVER_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+using resolveHandlerType =
+    std::function<void(boost::system::error_code,
+                       boost::asio::ip::tcp::resolver::results_type)>;
+
+class ClientResolverEntry {
+public:
+  ClientResolverEntry();
+  ~ClientResolverEntry();
+  boost::asio::ip::tcp::resolver::results_type results;
+  boost::system::error_code ec;
+  bool resolvedFlag, inFlightFlag;
+  // fresh until expireTime, may be served while refreshing until staleTime
+  std::chrono::steady_clock::time_point expireTime, staleTime;
+  std::vector<resolveHandlerType> handlerList;
+};
+
+/* Lifetimes of the cached lookups */
+class ClientResolverSettings {
+public:
+  ClientResolverSettings();
+  ~ClientResolverSettings();
+  std::chrono::seconds ttl, staleTtl, negativeTtl;
+};
+
+/* Asynchronous DNS resolver with a cache shared by all clients.
+ * The system resolver does not report record TTLs so entries live for the
+ * configured ttl. Expired entries are served for up to staleTtl more while a
+ * background lookup refreshes them. Failures are cached for negativeTtl.
+ */
+class ClientResolver {
+private:
+  boost::asio::io_context &ioContext;
+  std::mutex cacheMutex;
+  std::unordered_map<std::string, std::shared_ptr<ClientResolverEntry>>
+      cacheMap;
+  // guarded by cacheMutex
+  ClientResolverSettings settings;
+  // statistics
+  uint64_t hitNum, staleHitNum, missNum, negativeHitNum, lookupNum;
+  /* Starts a lookup for the entry. cacheMutex must be held. */
+  void startLookup(std::shared_ptr<ClientResolverEntry> entryPtr,
+                   std::string host, std::string port);
+  /* Keeps at most maxEntries hosts, lookups in flight are never dropped.
+   * cacheMutex must be held.
+   */
+  void evict(std::chrono::steady_clock::time_point now);
+
+public:
+  ClientResolver(boost::asio::io_context &);
+  ~ClientResolver();
+  std::size_t maxEntries;
+  void setSettings(const ClientResolverSettings &);
+  /* The handler is called inline on a cache hit, otherwise from the
+   * io_context once the lookup finishes. Concurrent misses for the same
+   * host share one lookup.
+   */
+  void asyncResolve(std::string host, std::string port,
+                    resolveHandlerType handler);
+  /* Blocks the caller until asyncResolve completes. Callers that can not
+   * wait on the io_context, a thread running it or one before it runs, pass
+   * waitFlag false and look up on the calling thread, bypassing the cache.
+   */
+  int resolve(std::string host, std::string port,
+              boost::asio::ip::tcp::resolver::results_type &results,
+              boost::system::error_code &ec, bool waitFlag);
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RESOLVER_H
@@ -0,0 +1,77 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientRetryBudget.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientRetryBudgetSettings::ClientRetryBudgetSettings() {
+  ratio = 0.1;
+  minPerSecond = 10;
+}
+ClientRetryBudgetSettings::~ClientRetryBudgetSettings() {}
+
+ClientRetryBudget::ClientRetryBudget() {
+  maxTokens = 100;
+  tokens = settings.minPerSecond;
+  refillTime = std::chrono::steady_clock::now();
+  withdrawNum = exhaustedNum = 0;
+}
+
+ClientRetryBudget::~ClientRetryBudget() {}
+
+void ClientRetryBudget::setSettings(
+    const ClientRetryBudgetSettings &settings_) {
+  const std::lock_guard<std::mutex> lock(budgetMutex);
+  // tokens earned at the old rate are kept
+  refill(std::chrono::steady_clock::now());
+  settings = settings_;
+}
+
+void ClientRetryBudget::refill(std::chrono::steady_clock::time_point now) {
+  std::chrono::duration<double> elapsed = now - refillTime;
+  refillTime = now;
+  tokens = std::min(maxTokens,
+                    tokens + elapsed.count() * settings.minPerSecond);
+}
+
+void ClientRetryBudget::deposit() {
+  const std::lock_guard<std::mutex> lock(budgetMutex);
+  tokens = std::min(maxTokens, tokens + settings.ratio);
+}
+
+bool ClientRetryBudget::withdraw() {
+  const std::lock_guard<std::mutex> lock(budgetMutex);
+  refill(std::chrono::steady_clock::now());
+  if (tokens < 1) {
+    exhaustedNum++;
+    return false;
+  }
+  tokens -= 1;
+  withdrawNum++;
+  return true;
+}
+
+int ClientRetryBudget::getStats(rapidjson::Value &statsValue,
+                                rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(budgetMutex);
+  refill(std::chrono::steady_clock::now());
+  statsValue.SetObject();
+  statsValue.AddMember("tokens", tokens, allocator);
+  statsValue.AddMember("withdrawn", withdrawNum, allocator);
+  statsValue.AddMember("exhausted", exhaustedNum, allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,71 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RETRY_BUDGET_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RETRY_BUDGET_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+class ClientRetryBudgetSettings {
+public:
+  ClientRetryBudgetSettings();
+  ~ClientRetryBudgetSettings();
+  // tokens deposited per request
+  double ratio;
+  double minPerSecond;
+};
+
+/* Token bucket shared by every client so that retries and hedged requests
+ * can not multiply the load on a failing upstream. Each request deposits
+ * ratio tokens, each retry or hedge takes one. minPerSecond tokens are added
+ * every second so low traffic can still retry.
+ */
+class ClientRetryBudget {
+private:
+  std::mutex budgetMutex;
+  double tokens;
+  // guarded by budgetMutex
+  ClientRetryBudgetSettings settings;
+  std::chrono::steady_clock::time_point refillTime;
+  uint64_t withdrawNum, exhaustedNum;
+  void refill(std::chrono::steady_clock::time_point now);
+
+public:
+  ClientRetryBudget();
+  ~ClientRetryBudget();
+  double maxTokens;
+  void setSettings(const ClientRetryBudgetSettings &);
+  void deposit();
+  /* Takes a token, false if the budget is exhausted */
+  bool withdraw();
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_RETRY_BUDGET_H
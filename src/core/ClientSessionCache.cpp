@@ -0,0 +1,121 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientSessionCache.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientSessionCache::ClientSessionCache() {
+  maxEntries = 1024;
+  fullHandshakeNum = resumedHandshakeNum = sessionStoreNum = 0;
+}
+ClientSessionCache::~ClientSessionCache() {}
+
+int ClientSessionCache::sslIndex() {
+  static int index =
+      SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+int ClientSessionCache::sslCtxIndex() {
+  static int index =
+      SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+int ClientSessionCache::attach(boost::asio::ssl::context &sslContext) {
+  SSL_CTX *ctx = sslContext.native_handle();
+  SSL_CTX_set_ex_data(ctx, sslCtxIndex(), this);
+  // sessions are only kept in this cache, not in the OpenSSL internal store
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                          SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, &ClientSessionCache::newSessionCallback);
+  return 0;
+}
+
+int ClientSessionCache::newSessionCallback(SSL *ssl, SSL_SESSION *session) {
+  ClientSessionCache *cachePtr = static_cast<ClientSessionCache *>(
+      SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), sslCtxIndex()));
+  const std::string *keyPtr =
+      static_cast<const std::string *>(SSL_get_ex_data(ssl, sslIndex()));
+  if (!cachePtr || !keyPtr) {
+    return 0;
+  }
+  cachePtr->store(*keyPtr, session);
+  // returning 1 keeps the reference OpenSSL passed in
+  return 1;
+}
+
+int ClientSessionCache::store(const std::string &key, SSL_SESSION *session) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  if (sessionMap.size() >= maxEntries &&
+      sessionMap.find(key) == sessionMap.end()) {
+    sessionMap.erase(sessionMap.begin());
+  }
+  sessionMap[key] = std::shared_ptr<SSL_SESSION>(session, SSL_SESSION_free);
+  sessionStoreNum++;
+  return 0;
+}
+
+int ClientSessionCache::clear() {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  sessionMap.clear();
+  return 0;
+}
+
+int ClientSessionCache::setSession(SSL *ssl, const std::string *key) {
+  SSL_set_ex_data(ssl, sslIndex(), const_cast<std::string *>(key));
+  std::shared_ptr<SSL_SESSION> sessionPtr;
+  {
+    const std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = sessionMap.find(*key);
+    if (it == sessionMap.end()) {
+      return -1;
+    }
+    sessionPtr = it->second;
+    if (SSL_SESSION_get_protocol_version(sessionPtr.get()) >= TLS1_3_VERSION) {
+      sessionMap.erase(it);
+    }
+  }
+  // SSL_set_session takes its own reference
+  if (SSL_set_session(ssl, sessionPtr.get()) != 1) {
+    return -1;
+  }
+  return 0;
+}
+
+int ClientSessionCache::addHandshake(SSL *ssl) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  if (SSL_session_reused(ssl)) {
+    resumedHandshakeNum++;
+  } else {
+    fullHandshakeNum++;
+  }
+  return 0;
+}
+
+int ClientSessionCache::getStats(
+    rapidjson::Value &statsValue,
+    rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  statsValue.SetObject();
+  statsValue.AddMember("fullHandshakes", fullHandshakeNum, allocator);
+  statsValue.AddMember("resumedHandshakes", resumedHandshakeNum, allocator);
+  statsValue.AddMember("sessionsStored", sessionStoreNum, allocator);
+  statsValue.AddMember("sessionsCached",
+                       static_cast<uint64_t>(sessionMap.size()), allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,84 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SESSION_CACHE_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SESSION_CACHE_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/ssl/context.hpp>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Client TLS sessions keyed by "scheme://host:port" so that reconnects,
+ * including those after the pool evicted an idle connection, resume instead
+ * of doing a full handshake. Early data is never sent: the asio SSL engine
+ * only writes application data once its handshake completed.
+ */
+class ClientSessionCache {
+private:
+  std::mutex cacheMutex;
+  std::unordered_map<std::string, std::shared_ptr<SSL_SESSION>> sessionMap;
+  // statistics
+  uint64_t fullHandshakeNum, resumedHandshakeNum, sessionStoreNum;
+  static int sslIndex();
+  static int sslCtxIndex();
+  /* OpenSSL calls this when the server issues a session. With TLS 1.3 this
+   * happens after the handshake, while reading the response.
+   */
+  static int newSessionCallback(SSL *, SSL_SESSION *);
+  int store(const std::string &key, SSL_SESSION *);
+
+public:
+  ClientSessionCache();
+  ~ClientSessionCache();
+  std::size_t maxEntries;
+  /* Enables client session caching on the context and routes new sessions to
+   * this cache
+   */
+  int attach(boost::asio::ssl::context &);
+  int clear();
+  /* Call before the handshake. The key must outlive the SSL object.
+   * TLS 1.3 tickets are taken out of the cache since they should only be
+   * used once.
+   */
+  int setSession(SSL *, const std::string *key);
+  /* Call after the handshake to count full and resumed handshakes */
+  int addHandshake(SSL *);
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SESSION_CACHE_H
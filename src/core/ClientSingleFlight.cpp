@@ -0,0 +1,85 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientSingleFlight.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientSingleFlight::ClientSingleFlight() { leaderNum = waiterNum = 0; }
+ClientSingleFlight::~ClientSingleFlight() {}
+
+bool ClientSingleFlight::join(const std::string &key, const void *owner,
+                              singleFlightHandlerType handler) {
+  const std::lock_guard<std::mutex> lock(flightMutex);
+  auto it = flightMap.find(key);
+  if (it == flightMap.end()) {
+    flightMap[key];
+    leaderNum++;
+    return true;
+  }
+  it->second.emplace_back(owner, std::move(handler));
+  waiterNum++;
+  return false;
+}
+
+bool ClientSingleFlight::leave(const std::string &key, const void *owner) {
+  const std::lock_guard<std::mutex> lock(flightMutex);
+  auto it = flightMap.find(key);
+  if (it == flightMap.end()) {
+    return false;
+  }
+  auto &waiterList = it->second;
+  for (auto waiterIt = waiterList.begin(); waiterIt != waiterList.end();
+       ++waiterIt) {
+    if (waiterIt->first == owner) {
+      waiterList.erase(waiterIt);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClientSingleFlight::finish(
+    const std::string &key, int rc,
+    std::shared_ptr<boost::beast::http::response<
+        boost::beast::http::string_body>>
+        responseBeast) {
+  std::vector<std::pair<const void *, singleFlightHandlerType>> waiterList;
+  {
+    const std::lock_guard<std::mutex> lock(flightMutex);
+    auto it = flightMap.find(key);
+    if (it == flightMap.end()) {
+      return;
+    }
+    waiterList = std::move(it->second);
+    flightMap.erase(it);
+  }
+  for (auto &waiter : waiterList) {
+    waiter.second(rc, responseBeast);
+  }
+}
+
+int ClientSingleFlight::getStats(
+    rapidjson::Value &statsValue,
+    rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(flightMutex);
+  statsValue.SetObject();
+  statsValue.AddMember("leaders", leaderNum, allocator);
+  statsValue.AddMember("waiters", waiterNum, allocator);
+  statsValue.AddMember("inFlight", static_cast<uint64_t>(flightMap.size()),
+                       allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
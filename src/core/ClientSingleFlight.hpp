@@ -0,0 +1,91 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SINGLE_FLIGHT_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SINGLE_FLIGHT_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/string_body.hpp>
+
+// Local Project
+#include "Util.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+// called with the leader's result code and its response, which is shared
+using singleFlightHandlerType = std::function<void(
+    int, std::shared_ptr<
+             boost::beast::http::response<boost::beast::http::string_body>>)>;
+
+/* Coalesces identical requests in flight. The first request of a key is the
+ * leader and goes upstream. Requests that join while it runs wait for its
+ * response instead of sending their own.
+ */
+class ClientSingleFlight {
+private:
+  std::mutex flightMutex;
+  // waiters of each key in flight and their owners
+  std::unordered_map<
+      std::string,
+      std::vector<std::pair<const void *, singleFlightHandlerType>>>
+      flightMap;
+  // statistics
+  uint64_t leaderNum, waiterNum;
+
+public:
+  ClientSingleFlight();
+  ~ClientSingleFlight();
+  /* Returns true if the caller leads the key and must call finish. Otherwise
+   * the handler is called once the leader finished.
+   */
+  bool join(const std::string &key, const void *owner,
+            singleFlightHandlerType handler);
+  /* Removes the owner's waiter of the key. Returns false if the leader
+   * already finished and the handler runs or ran.
+   */
+  bool leave(const std::string &key, const void *owner);
+  /* Hands the response to every waiter of the key. It must not be modified
+   * afterwards.
+   */
+  void finish(const std::string &key, int rc,
+              std::shared_ptr<boost::beast::http::response<
+                  boost::beast::http::string_body>>
+                  responseBeast);
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_SINGLE_FLIGHT_H
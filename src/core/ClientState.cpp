@@ -0,0 +1,537 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientState.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientSettings::ClientSettings() {
+  skipPeerVerification = skipHostnameVerification = false;
+  http2Flag = true;
+  http2WindowSize = 1 << 22;
+  decodeFlag = true;
+  timeout = std::chrono::milliseconds(0);
+  retryBackoff = std::chrono::milliseconds(50);
+  retryBackoffMax = std::chrono::milliseconds(1000);
+  retryMax = 0;
+  hedgePercentile = 95;
+  coalesceFlag = false;
+  coalesceHeaderList = {"accept", "accept-encoding", "accept-language",
+                        "authorization", "cookie"};
+  connectStagger = std::chrono::milliseconds(250);
+  cacheSize = 33554432;
+}
+ClientSettings::~ClientSettings() {}
+
+ClientState::ClientState() {
+  settingsPtr = std::make_shared<ClientSettings>();
+  poolPtr = std::make_shared<ClientPool>(ioContext);
+  resolverPtr = std::make_shared<ClientResolver>(ioContext);
+  sessionCachePtr = std::make_shared<ClientSessionCache>();
+  retryBudgetPtr = std::make_shared<ClientRetryBudget>();
+  latencyPtr = std::make_shared<ClientLatency>();
+  cachePtr = std::make_shared<ClientCache>();
+  singleFlightPtr = std::make_shared<ClientSingleFlight>();
+  certManagerPtr =
+      std::make_shared<bookfiler::certificate::ManagerNativeImpl>();
+  sslSkipPeerVerification = false;
+  sslCheckInterval = std::chrono::seconds(30);
+  sslContextLoadNum = 0;
+  ioThreadNum = 2;
+  http2ConnectionNum = http2StreamNum = 0;
+  decodedResponseNum = decodedEncodedBytes = decodedBytes = 0;
+  retryNum = hedgeNum = hedgeWinNum = timeoutNum = 0;
+  connectNum = connectAttemptNum = connectFallbackNum = 0;
+}
+ClientState::~ClientState() {
+  workGuardPtr.reset();
+  ioContext.stop();
+  const std::lock_guard<std::mutex> lock(ioThreadMutex);
+  for (auto &ioThread : ioThreadList) {
+    if (ioThread.joinable()) {
+      ioThread.join();
+    }
+  }
+}
+
+int ClientState::init() {
+  startThreads();
+  // The system store is loaded once at module init
+  return loadSslContext();
+}
+
+int ClientState::startThreads() {
+  const std::lock_guard<std::mutex> lock(ioThreadMutex);
+  if (!workGuardPtr) {
+    workGuardPtr = std::make_unique<boost::asio::executor_work_guard<
+        boost::asio::io_context::executor_type>>(ioContext.get_executor());
+  }
+  while (static_cast<int>(ioThreadList.size()) < ioThreadNum) {
+    ioThreadList.emplace_back([this]() { ioContext.run(); });
+  }
+  return 0;
+}
+
+bool ClientState::canWaitOnIo() {
+  if (ioContext.get_executor().running_in_this_thread()) {
+    return false;
+  }
+  const std::lock_guard<std::mutex> lock(ioThreadMutex);
+  return !ioThreadList.empty();
+}
+
+std::shared_ptr<const ClientSettings> ClientState::getSettings() {
+  return std::atomic_load(&settingsPtr);
+}
+
+int ClientState::setSettingsDoc(
+    std::shared_ptr<rapidjson::Value> settingsDoc_) {
+  std::atomic_store(&settingsDoc, settingsDoc_);
+  return 0;
+}
+
+std::shared_ptr<rapidjson::Value> ClientState::getSettingsDoc() {
+  return std::atomic_load(&settingsDoc);
+}
+
+int ClientState::extractSettings() {
+  /* Get settings from JSON document */
+  std::shared_ptr<rapidjson::Value> settingsDocPtr = getSettingsDoc();
+  if (!settingsDocPtr || !settingsDocPtr->IsObject()) {
+    logStatus("::ClientState::extractSettings",
+              "ERROR: Settings document not an object.");
+    return -1;
+  }
+  JsonImpl json;
+  // requests in flight keep the snapshot they started with
+  auto newSettingsPtr = std::make_shared<ClientSettings>(*getSettings());
+  auto CaInfoPathOpt = json.getMemberString(*settingsDocPtr, "CaInfoPath");
+  if (CaInfoPathOpt) {
+    newSettingsPtr->CaInfoPath = *CaInfoPathOpt;
+  }
+  if (settingsDocPtr->HasMember("skipPeerVerification") &&
+      (*settingsDocPtr)["skipPeerVerification"].IsBool()) {
+    newSettingsPtr->skipPeerVerification =
+        (*settingsDocPtr)["skipPeerVerification"].GetBool();
+  }
+  if (settingsDocPtr->HasMember("skipHostnameVerification") &&
+      (*settingsDocPtr)["skipHostnameVerification"].IsBool()) {
+    newSettingsPtr->skipHostnameVerification =
+        (*settingsDocPtr)["skipHostnameVerification"].GetBool();
+  }
+
+  int rc = 0;
+  if (settingsDocPtr->HasMember("client")) {
+    const rapidjson::Value &clientJson = (*settingsDocPtr)["client"];
+    if (clientJson.IsObject()) {
+      rc = extractClientSettings(clientJson, *newSettingsPtr);
+    } else {
+      logStatus("::ClientState::extractSettings",
+                "ERROR: Settings document client member is not an object.");
+      rc = -1;
+    }
+  }
+  poolPtr->setSettings(newSettingsPtr->poolSettings);
+  resolverPtr->setSettings(newSettingsPtr->resolverSettings);
+  retryBudgetPtr->setSettings(newSettingsPtr->retryBudgetSettings);
+  cachePtr->setMaxSize(newSettingsPtr->cacheSize);
+  std::atomic_store(&settingsPtr, std::shared_ptr<const ClientSettings>(
+                                      std::move(newSettingsPtr)));
+  {
+    // force getSslContext to compare against the new settings
+    const std::lock_guard<std::mutex> lock(sslContextMutex);
+    sslCheckTime = {};
+  }
+  getSslContext();
+  return rc;
+}
+
+int ClientState::extractClientSettings(const rapidjson::Value &clientJson,
+                                       ClientSettings &settings) {
+  JsonImpl json;
+  auto poolMaxPerHostOpt = json.getMemberInt(clientJson, "poolMaxPerHost");
+  if (poolMaxPerHostOpt) {
+    settings.poolSettings.maxPerHost = std::max<int>(1, *poolMaxPerHostOpt);
+  }
+  if (clientJson.HasMember("poolAdaptive") &&
+      clientJson["poolAdaptive"].IsBool()) {
+    settings.poolSettings.adaptiveFlag = clientJson["poolAdaptive"].GetBool();
+  }
+  auto poolMinPerHostOpt = json.getMemberInt(clientJson, "poolMinPerHost");
+  if (poolMinPerHostOpt) {
+    settings.poolSettings.minPerHost = std::max<int>(1, *poolMinPerHostOpt);
+  }
+  auto poolLatencyToleranceOpt =
+      json.getMemberInt(clientJson, "poolLatencyTolerance");
+  if (poolLatencyToleranceOpt) {
+    // percent of the long term latency
+    settings.poolSettings.limitTolerance =
+        std::max<int>(100, *poolLatencyToleranceOpt) / 100.0;
+  }
+  auto poolIdleTimeoutOpt = json.getMemberInt(clientJson, "poolIdleTimeout");
+  if (poolIdleTimeoutOpt) {
+    settings.poolSettings.idleTimeout =
+        std::chrono::seconds(*poolIdleTimeoutOpt);
+  }
+  auto connectStaggerOpt = json.getMemberInt(clientJson, "connectStagger");
+  if (connectStaggerOpt) {
+    // RFC 8305 recommends at least 10 milliseconds
+    settings.connectStagger =
+        std::chrono::milliseconds(std::max<int>(10, *connectStaggerOpt));
+  }
+  auto dnsTtlOpt = json.getMemberInt(clientJson, "dnsTtl");
+  if (dnsTtlOpt) {
+    settings.resolverSettings.ttl = std::chrono::seconds(*dnsTtlOpt);
+  }
+  auto dnsStaleTtlOpt = json.getMemberInt(clientJson, "dnsStaleTtl");
+  if (dnsStaleTtlOpt) {
+    settings.resolverSettings.staleTtl =
+        std::chrono::seconds(*dnsStaleTtlOpt);
+  }
+  auto dnsNegativeTtlOpt = json.getMemberInt(clientJson, "dnsNegativeTtl");
+  if (dnsNegativeTtlOpt) {
+    settings.resolverSettings.negativeTtl =
+        std::chrono::seconds(*dnsNegativeTtlOpt);
+  }
+  auto poolAcquireTimeoutOpt =
+      json.getMemberInt(clientJson, "poolAcquireTimeout");
+  if (poolAcquireTimeoutOpt) {
+    settings.poolSettings.acquireTimeout =
+        std::chrono::seconds(*poolAcquireTimeoutOpt);
+  }
+  if (clientJson.HasMember("http2") && clientJson["http2"].IsBool()) {
+    settings.http2Flag = clientJson["http2"].GetBool();
+  }
+  auto http2WindowSizeOpt = json.getMemberInt(clientJson, "http2WindowSize");
+  if (http2WindowSizeOpt) {
+    // the protocol minimum is the 65535 byte default window
+    settings.http2WindowSize = std::max<int>(65535, *http2WindowSizeOpt);
+  }
+  if (clientJson.HasMember("decompress") && clientJson["decompress"].IsBool()) {
+    settings.decodeFlag = clientJson["decompress"].GetBool();
+  }
+  auto timeoutOpt = json.getMemberInt(clientJson, "timeout");
+  if (timeoutOpt) {
+    settings.timeout =
+        std::chrono::milliseconds(std::max<int>(0, *timeoutOpt));
+  }
+  auto retriesOpt = json.getMemberInt(clientJson, "retries");
+  if (retriesOpt) {
+    settings.retryMax = std::max<int>(0, *retriesOpt);
+  }
+  auto retryBackoffOpt = json.getMemberInt(clientJson, "retryBackoff");
+  if (retryBackoffOpt) {
+    settings.retryBackoff =
+        std::chrono::milliseconds(std::max<int>(1, *retryBackoffOpt));
+  }
+  auto retryBackoffMaxOpt = json.getMemberInt(clientJson, "retryBackoffMax");
+  if (retryBackoffMaxOpt) {
+    settings.retryBackoffMax =
+        std::chrono::milliseconds(std::max<int>(1, *retryBackoffMaxOpt));
+  }
+  auto retryBudgetPercentOpt =
+      json.getMemberInt(clientJson, "retryBudgetPercent");
+  if (retryBudgetPercentOpt) {
+    settings.retryBudgetSettings.ratio =
+        std::max<int>(0, *retryBudgetPercentOpt) / 100.0;
+  }
+  auto retryBudgetMinPerSecondOpt =
+      json.getMemberInt(clientJson, "retryBudgetMinPerSecond");
+  if (retryBudgetMinPerSecondOpt) {
+    settings.retryBudgetSettings.minPerSecond =
+        std::max<int>(0, *retryBudgetMinPerSecondOpt);
+  }
+  auto hedgePercentileOpt = json.getMemberInt(clientJson, "hedgePercentile");
+  if (hedgePercentileOpt) {
+    settings.hedgePercentile = std::clamp<int>(*hedgePercentileOpt, 0, 100);
+  }
+  auto cacheSizeOpt = json.getMemberInt(clientJson, "cacheSize");
+  if (cacheSizeOpt) {
+    settings.cacheSize = std::max<int>(0, *cacheSizeOpt);
+  }
+  if (clientJson.HasMember("coalesce") && clientJson["coalesce"].IsBool()) {
+    settings.coalesceFlag = clientJson["coalesce"].GetBool();
+  }
+  if (clientJson.HasMember("coalesceHeaders") &&
+      clientJson["coalesceHeaders"].IsArray()) {
+    settings.coalesceHeaderList.clear();
+    for (auto &headerJson : clientJson["coalesceHeaders"].GetArray()) {
+      if (headerJson.IsString()) {
+        settings.coalesceHeaderList.push_back(
+            boost::algorithm::to_lower_copy(std::string(headerJson.GetString())));
+      }
+    }
+  }
+  if (clientJson.HasMember("upstreamGroups") &&
+      clientJson["upstreamGroups"].IsObject()) {
+    std::unordered_map<std::string, std::shared_ptr<ClientUpstreamGroup>>
+        groupMap;
+    {
+      const std::lock_guard<std::mutex> lock(upstreamGroupMutex);
+      groupMap = upstreamGroupMap;
+    }
+    std::unordered_map<std::string, std::shared_ptr<ClientUpstreamGroup>>
+        newGroupMap;
+    for (auto &member : clientJson["upstreamGroups"].GetObject()) {
+      const std::string name = member.name.GetString();
+      rapidjson::StringBuffer buffer;
+      rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+      member.value.Accept(writer);
+      const std::string settingsStr = buffer.GetString();
+      /* An unchanged group keeps its health, ejections, latencies and the
+       * leases counted on it
+       */
+      auto it = groupMap.find(name);
+      if (it != groupMap.end() && it->second->settingsStr == settingsStr) {
+        newGroupMap[name] = it->second;
+        continue;
+      }
+      auto groupPtr = std::make_shared<ClientUpstreamGroup>();
+      groupPtr->name = name;
+      groupPtr->settingsStr = settingsStr;
+      if (groupPtr->extractSettings(member.value) < 0) {
+        continue;
+      }
+      // the health checks of replaced groups stop with them
+      groupPtr->startHealthCheck(weak_from_this(), ioContext);
+      newGroupMap[name] = groupPtr;
+    }
+    const std::lock_guard<std::mutex> lock(upstreamGroupMutex);
+    upstreamGroupMap.swap(newGroupMap);
+  }
+  auto threadsOpt = json.getMemberInt(clientJson, "threads");
+  if (threadsOpt) {
+    {
+      const std::lock_guard<std::mutex> lock(ioThreadMutex);
+      ioThreadNum = std::max<int>(1, *threadsOpt);
+    }
+    startThreads();
+  }
+  return 0;
+}
+
+int ClientState::loadSslContext() {
+  // the certificate manager holds a single store so loads are serialized
+  const std::lock_guard<std::mutex> loadLock(sslLoadMutex);
+  auto settings = getSettings();
+  const std::string &caInfoPath = settings->CaInfoPath;
+  const bool skipPeer = settings->skipPeerVerification;
+  std::filesystem::file_time_type writeTime{};
+
+  int rc = -1;
+  if (!caInfoPath.empty()) {
+    std::error_code ec;
+    writeTime = std::filesystem::last_write_time(caInfoPath, ec);
+    rc = certManagerPtr->createX509StoreFromFile(caInfoPath);
+    if (rc < 0) {
+      logStatus("::ClientState::loadSslContext",
+                "WARNING: Could not load " + caInfoPath +
+                    ", using the system store.");
+    }
+  }
+  if (rc < 0) {
+    rc = certManagerPtr->createX509Store();
+  }
+  std::shared_ptr<X509_STORE> storePtr = certManagerPtr->getX509Store();
+
+  std::shared_ptr<boost::asio::ssl::context> newSslContext =
+      std::make_shared<boost::asio::ssl::context>(
+          boost::asio::ssl::context::tls_client);
+  if (rc < 0 || !storePtr) {
+    logStatus("::ClientState::loadSslContext",
+              "WARNING: Could not create the X509 store, using default paths.");
+    newSslContext->set_default_verify_paths();
+  } else {
+    // the context takes its own reference to the store
+    SSL_CTX_set1_cert_store(newSslContext->native_handle(), storePtr.get());
+  }
+  if (skipPeer) {
+    newSslContext->set_verify_mode(boost::asio::ssl::context::verify_none);
+  } else {
+    newSslContext->set_verify_mode(
+        boost::asio::ssl::context::verify_peer |
+        boost::asio::ssl::context::verify_fail_if_no_peer_cert);
+  }
+  // tag::ctx_setup_source[]
+  boost::certify::enable_native_https_server_verification(*newSslContext);
+  // end::ctx_setup_source[]
+  // sessions were verified against the old trust store
+  sessionCachePtr->clear();
+  sessionCachePtr->attach(*newSslContext);
+
+  const std::lock_guard<std::mutex> lock(sslContextMutex);
+  sslContext = newSslContext;
+  sslCaInfoPath = caInfoPath;
+  sslSkipPeerVerification = skipPeer;
+  sslCaInfoWriteTime = writeTime;
+  sslCheckTime = std::chrono::steady_clock::now();
+  sslContextLoadNum++;
+  return rc;
+}
+
+std::shared_ptr<boost::asio::ssl::context> ClientState::getSslContext() {
+  auto settings = getSettings();
+  {
+    const std::lock_guard<std::mutex> lock(sslContextMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (sslContext && now - sslCheckTime < sslCheckInterval) {
+      return sslContext;
+    }
+    sslCheckTime = now;
+    bool changed = !sslContext || settings->CaInfoPath != sslCaInfoPath ||
+                   settings->skipPeerVerification != sslSkipPeerVerification;
+    if (!changed && !sslCaInfoPath.empty()) {
+      std::error_code ec;
+      auto writeTime = std::filesystem::last_write_time(sslCaInfoPath, ec);
+      changed = !ec && writeTime != sslCaInfoWriteTime;
+    }
+    if (!changed) {
+      return sslContext;
+    }
+  }
+  logStatus("::ClientState::getSslContext", "Reloading the client trust store");
+  loadSslContext();
+  const std::lock_guard<std::mutex> lock(sslContextMutex);
+  return sslContext;
+}
+
+std::shared_ptr<ClientUpstreamGroup>
+ClientState::getUpstreamGroup(const std::string &name) {
+  const std::lock_guard<std::mutex> lock(upstreamGroupMutex);
+  auto it = upstreamGroupMap.find(name);
+  if (it == upstreamGroupMap.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+std::shared_ptr<ClientHttp2Connection>
+ClientState::getHttp2Connection(const std::string &key) {
+  const std::lock_guard<std::mutex> lock(http2Mutex);
+  auto it = http2Map.find(key);
+  if (it == http2Map.end()) {
+    return nullptr;
+  }
+  if (!it->second->isOpen()) {
+    http2Map.erase(it);
+    return nullptr;
+  }
+  http2StreamNum++;
+  return it->second;
+}
+
+std::shared_ptr<ClientHttp2Connection>
+ClientState::newHttp2Connection(const std::string &key,
+                                std::shared_ptr<ClientConnection> connectionPtr) {
+  auto http2Ptr = std::make_shared<ClientHttp2Connection>(ioContext);
+  http2Ptr->windowSize = getSettings()->http2WindowSize;
+  if (http2Ptr->start(connectionPtr) < 0) {
+    return nullptr;
+  }
+  std::shared_ptr<ClientHttp2Connection> sharedPtr;
+  {
+    const std::lock_guard<std::mutex> lock(http2Mutex);
+    http2ConnectionNum++;
+    http2StreamNum++;
+    std::shared_ptr<ClientHttp2Connection> &mapPtr = http2Map[key];
+    if (!mapPtr || !mapPtr->isOpen()) {
+      mapPtr = http2Ptr;
+      return http2Ptr;
+    }
+    sharedPtr = mapPtr;
+  }
+  // another request opened a connection first, use that one
+  http2Ptr->closeWhenIdle();
+  return sharedPtr;
+}
+
+int ClientState::getStats(rapidjson::Document &statsDoc) {
+  statsDoc.SetObject();
+  rapidjson::Value poolValue;
+  poolPtr->getStats(poolValue, statsDoc.GetAllocator());
+  statsDoc.AddMember("pool", poolValue, statsDoc.GetAllocator());
+  rapidjson::Value dnsValue;
+  resolverPtr->getStats(dnsValue, statsDoc.GetAllocator());
+  statsDoc.AddMember("dns", dnsValue, statsDoc.GetAllocator());
+  rapidjson::Value connectValue;
+  connectValue.SetObject();
+  connectValue.AddMember("connects", connectNum.load(),
+                         statsDoc.GetAllocator());
+  connectValue.AddMember("attempts", connectAttemptNum.load(),
+                         statsDoc.GetAllocator());
+  connectValue.AddMember("fallbacks", connectFallbackNum.load(),
+                         statsDoc.GetAllocator());
+  statsDoc.AddMember("connect", connectValue, statsDoc.GetAllocator());
+  rapidjson::Value tlsValue;
+  sessionCachePtr->getStats(tlsValue, statsDoc.GetAllocator());
+  tlsValue.AddMember("contextLoads", sslContextLoadNum.load(),
+                     statsDoc.GetAllocator());
+  statsDoc.AddMember("tls", tlsValue, statsDoc.GetAllocator());
+  rapidjson::Value http2Value;
+  http2Value.SetObject();
+  {
+    const std::lock_guard<std::mutex> lock(http2Mutex);
+    uint64_t openNum = 0;
+    for (auto &http2Pair : http2Map) {
+      openNum += http2Pair.second->isOpen() ? 1 : 0;
+    }
+    http2Value.AddMember("connections", http2ConnectionNum,
+                         statsDoc.GetAllocator());
+    http2Value.AddMember("openConnections", openNum, statsDoc.GetAllocator());
+    http2Value.AddMember("streams", http2StreamNum, statsDoc.GetAllocator());
+  }
+  statsDoc.AddMember("http2", http2Value, statsDoc.GetAllocator());
+  rapidjson::Value encodingValue;
+  encodingValue.SetObject();
+  encodingValue.AddMember("responses", decodedResponseNum.load(),
+                          statsDoc.GetAllocator());
+  encodingValue.AddMember("encodedBytes", decodedEncodedBytes.load(),
+                          statsDoc.GetAllocator());
+  encodingValue.AddMember("decodedBytes", decodedBytes.load(),
+                          statsDoc.GetAllocator());
+  statsDoc.AddMember("encoding", encodingValue, statsDoc.GetAllocator());
+  rapidjson::Value retryValue;
+  retryValue.SetObject();
+  retryValue.AddMember("retries", retryNum.load(), statsDoc.GetAllocator());
+  retryValue.AddMember("hedges", hedgeNum.load(), statsDoc.GetAllocator());
+  retryValue.AddMember("hedgeWins", hedgeWinNum.load(),
+                       statsDoc.GetAllocator());
+  retryValue.AddMember("timeouts", timeoutNum.load(), statsDoc.GetAllocator());
+  rapidjson::Value budgetValue;
+  retryBudgetPtr->getStats(budgetValue, statsDoc.GetAllocator());
+  retryValue.AddMember("budget", budgetValue, statsDoc.GetAllocator());
+  statsDoc.AddMember("retry", retryValue, statsDoc.GetAllocator());
+  rapidjson::Value cacheValue;
+  cachePtr->getStats(cacheValue, statsDoc.GetAllocator());
+  statsDoc.AddMember("cache", cacheValue, statsDoc.GetAllocator());
+  rapidjson::Value coalesceValue;
+  singleFlightPtr->getStats(coalesceValue, statsDoc.GetAllocator());
+  statsDoc.AddMember("coalesce", coalesceValue, statsDoc.GetAllocator());
+  rapidjson::Value upstreamsValue;
+  upstreamsValue.SetObject();
+  {
+    const std::lock_guard<std::mutex> lock(upstreamGroupMutex);
+    for (auto &groupPair : upstreamGroupMap) {
+      rapidjson::Value groupValue;
+      groupPair.second->getStats(groupValue, statsDoc.GetAllocator());
+      upstreamsValue.AddMember(
+          rapidjson::Value(groupPair.first.c_str(), statsDoc.GetAllocator()),
+          groupValue, statsDoc.GetAllocator());
+    }
+  }
+  statsDoc.AddMember("upstreams", upstreamsValue, statsDoc.GetAllocator());
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,198 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STATE_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STATE_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/certify/https_verification.hpp>
+
+// Local Project
+#include "ClientCache.hpp"
+#include "ClientConnector.hpp"
+#include "ClientHttp2.hpp"
+#include "ClientLatency.hpp"
+#include "ClientPool.hpp"
+#include "ClientResolver.hpp"
+#include "ClientRetryBudget.hpp"
+#include "ClientSessionCache.hpp"
+#include "ClientSingleFlight.hpp"
+#include "ClientUpstream.hpp"
+#include "certificateManager.hpp"
+#include "json.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Settings read by requests on any thread. extractSettings publishes a new
+ * snapshot, a published one is never modified.
+ */
+class ClientSettings {
+public:
+  ClientSettings();
+  ~ClientSettings();
+  std::string CaInfoPath;
+  bool skipPeerVerification, skipHostnameVerification;
+  // offer h2 through ALPN
+  bool http2Flag;
+  int32_t http2WindowSize;
+  // send Accept-Encoding and decode gzip and deflate bodies
+  bool decodeFlag;
+  // defaults for requests that do not set their own, zero timeout is none
+  std::chrono::milliseconds timeout, retryBackoff, retryBackoffMax;
+  int retryMax;
+  // hedge after this percentile of the host's latency, 0 disables hedging
+  int hedgePercentile;
+  // head start of each connection attempt over the next address
+  std::chrono::milliseconds connectStagger;
+  // default for clients that do not call setCoalesce
+  bool coalesceFlag;
+  // lower case request headers that must match for requests to coalesce
+  std::vector<std::string> coalesceHeaderList;
+  // handed to the shared objects, which keep their own copy under their lock
+  ClientPoolSettings poolSettings;
+  ClientResolverSettings resolverSettings;
+  ClientRetryBudgetSettings retryBudgetSettings;
+  std::size_t cacheSize;
+};
+
+/* State shared by every client created from the module.
+ */
+class ClientState : public std::enable_shared_from_this<ClientState> {
+private:
+  // read and replaced with std::atomic_load and std::atomic_store
+  std::shared_ptr<const ClientSettings> settingsPtr;
+  // read and replaced with std::atomic_load and std::atomic_store
+  std::shared_ptr<rapidjson::Value> settingsDoc;
+  std::mutex sslContextMutex, sslLoadMutex;
+  std::shared_ptr<boost::asio::ssl::context> sslContext;
+  std::shared_ptr<bookfiler::certificate::ManagerNativeImpl> certManagerPtr;
+  // the trust store source the current sslContext was built from
+  std::string sslCaInfoPath;
+  bool sslSkipPeerVerification;
+  std::filesystem::file_time_type sslCaInfoWriteTime;
+  std::chrono::steady_clock::time_point sslCheckTime;
+  // keeps the io_context running while there is no outstanding work
+  std::unique_ptr<boost::asio::executor_work_guard<
+      boost::asio::io_context::executor_type>>
+      workGuardPtr;
+  std::mutex ioThreadMutex, http2Mutex, upstreamGroupMutex;
+  // one multiplexed connection per "scheme://host:port"
+  std::unordered_map<std::string, std::shared_ptr<ClientHttp2Connection>>
+      http2Map;
+  uint64_t http2ConnectionNum, http2StreamNum;
+  std::vector<std::thread> ioThreadList;
+  /* Starts threads running ioContext until there are ioThreadNum of them.
+   * The pool only grows, threads are joined on destruction.
+   */
+  int startThreads();
+  /* Builds a new client TLS context and X509 store from CaInfoPath, or from
+   * the system store if CaInfoPath is empty or cannot be loaded.
+   */
+  int loadSslContext();
+  /* Reads the "client" object of the settings document */
+  int extractClientSettings(const rapidjson::Value &, ClientSettings &);
+
+public:
+  ClientState();
+  ~ClientState();
+  /* Builds the shared client TLS context from the system store and starts
+   * the threads running ioContext
+   */
+  int init();
+  int setSettingsDoc(std::shared_ptr<rapidjson::Value>);
+  std::shared_ptr<rapidjson::Value> getSettingsDoc();
+  /* Reads CaInfoPath, the verification flags and the "client" object of the
+   * settings document
+   */
+  int extractSettings();
+  int getStats(rapidjson::Document &);
+  /* Returns the current settings, they stay valid while the caller holds
+   * them
+   */
+  std::shared_ptr<const ClientSettings> getSettings();
+  /* False on a thread running ioContext and before init() started its
+   * threads. Waiting there on work of ioContext would never return.
+   */
+  bool canWaitOnIo();
+  /* Returns the shared client TLS context. The CA bundle is checked for
+   * changes at most once every sslCheckInterval and the context is only
+   * rebuilt when the bundle changed.
+   */
+  std::shared_ptr<boost::asio::ssl::context> getSslContext();
+  /* Returns the open HTTP/2 connection to the key, if there is one */
+  std::shared_ptr<ClientHttp2Connection>
+  getHttp2Connection(const std::string &key);
+  /* Returns the upstream group from the settings or nullptr */
+  std::shared_ptr<ClientUpstreamGroup>
+  getUpstreamGroup(const std::string &name);
+  /* Starts HTTP/2 on a connection whose handshake selected h2. It becomes the
+   * shared connection to the key unless another one is already open, in
+   * which case that one is returned and the new one is closed.
+   */
+  std::shared_ptr<ClientHttp2Connection>
+  newHttp2Connection(const std::string &key,
+                     std::shared_ptr<ClientConnection> connectionPtr);
+  /* Runs asynchronous lookups and requests sent with ClientImpl::endAsync.
+   * Pooled sockets are bound to this context and are also used with
+   * synchronous calls by ClientImpl::end.
+   */
+  boost::asio::io_context ioContext;
+  std::shared_ptr<ClientPool> poolPtr;
+  std::shared_ptr<ClientResolver> resolverPtr;
+  std::shared_ptr<ClientSessionCache> sessionCachePtr;
+  std::shared_ptr<ClientRetryBudget> retryBudgetPtr;
+  std::shared_ptr<ClientLatency> latencyPtr;
+  std::shared_ptr<ClientCache> cachePtr;
+  std::shared_ptr<ClientSingleFlight> singleFlightPtr;
+  // "upstreamGroups" of the settings, their health checks run on ioContext
+  std::unordered_map<std::string, std::shared_ptr<ClientUpstreamGroup>>
+      upstreamGroupMap;
+  std::chrono::seconds sslCheckInterval;
+  // guarded by ioThreadMutex
+  int ioThreadNum;
+  std::atomic<uint64_t> decodedResponseNum, decodedEncodedBytes, decodedBytes;
+  std::atomic<uint64_t> retryNum, hedgeNum, hedgeWinNum, timeoutNum;
+  std::atomic<uint64_t> connectNum, connectAttemptNum, connectFallbackNum;
+  std::atomic<uint64_t> sslContextLoadNum;
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STATE_H
@@ -0,0 +1,117 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientStream.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientStream::ClientStream(clientTransport transport_,
+                           boost::asio::io_context &ioContext,
+                           boost::asio::ssl::context *sslContext)
+    : transport(transport_) {
+  switch (transport) {
+  case clientTransport::tls:
+    tlsPtr = std::make_unique<tlsStreamType>(ioContext, *sslContext);
+    break;
+  case clientTransport::local:
+    unixPtr = std::make_unique<unixSocketType>(ioContext);
+    break;
+  default:
+    tcpPtr = std::make_unique<boost::asio::ip::tcp::socket>(ioContext);
+  }
+}
+ClientStream::~ClientStream() {}
+
+clientTransport ClientStream::getTransport() { return transport; }
+
+ClientStream::tlsStreamType *ClientStream::tls() { return tlsPtr.get(); }
+
+boost::asio::ip::tcp::socket *ClientStream::tcpSocket() {
+  if (tlsPtr) {
+    return &tlsPtr->next_layer();
+  }
+  return tcpPtr.get();
+}
+
+ClientStream::unixSocketType *ClientStream::unixSocket() {
+  return unixPtr.get();
+}
+
+ClientStream::executor_type ClientStream::get_executor() {
+  if (tlsPtr) {
+    return tlsPtr->get_executor();
+  }
+  if (unixPtr) {
+    return unixPtr->get_executor();
+  }
+  return tcpPtr->get_executor();
+}
+
+bool ClientStream::isOpen() {
+  if (unixPtr) {
+    return unixPtr->is_open();
+  }
+  return tcpSocket()->is_open();
+}
+
+void ClientStream::close() {
+  if (tlsPtr) {
+    /* The connection is dropped without sending close_notify. Mark the TLS
+     * shutdown as done or OpenSSL flags the session as not resumable.
+     */
+    SSL_set_shutdown(tlsPtr->native_handle(),
+                     SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+  auto closeSocket = [](auto &socket) {
+    boost::system::error_code ec;
+    socket.shutdown(boost::asio::socket_base::shutdown_both, ec);
+    socket.close(ec);
+  };
+  if (unixPtr) {
+    closeSocket(*unixPtr);
+  } else {
+    closeSocket(*tcpSocket());
+  }
+}
+
+int ClientStream::peekIdle() {
+  /* An idle keep-alive socket must have nothing to read. EOF means the peer
+   * closed it and unexpected bytes mean the stream is out of sync.
+   */
+  auto peek = [](auto &socket) {
+    if (!socket.is_open()) {
+      return -1;
+    }
+    boost::system::error_code ec, ec2;
+    char peekChar;
+    socket.non_blocking(true, ec);
+    if (ec) {
+      return -1;
+    }
+    socket.receive(boost::asio::buffer(&peekChar, 1),
+                   boost::asio::socket_base::message_peek, ec);
+    socket.non_blocking(false, ec2);
+    if (ec == boost::asio::error::would_block ||
+        ec == boost::asio::error::try_again) {
+      return 0;
+    }
+    return -1;
+  };
+  if (unixPtr) {
+    return peek(*unixPtr);
+  }
+  return peek(*tcpSocket());
+}
+
+} // namespace HTTP
+} // namespace bookfiler
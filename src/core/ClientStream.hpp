@@ -0,0 +1,162 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STREAM_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STREAM_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/ssl/stream.hpp>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* http:// over TCP, https:// over TLS, or a Unix domain socket */
+enum class clientTransport { tcp, tls, local };
+
+/* The socket of a client connection with one of the transports. It is a
+ * Beast sync and async stream, so requests are written and read the same way
+ * on every transport. Only one of the pointers below is set.
+ */
+class ClientStream {
+public:
+  using executor_type = boost::asio::ip::tcp::socket::executor_type;
+  using tlsStreamType = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+  using unixSocketType = boost::asio::local::stream_protocol::socket;
+
+private:
+  clientTransport transport;
+  std::unique_ptr<boost::asio::ip::tcp::socket> tcpPtr;
+  std::unique_ptr<tlsStreamType> tlsPtr;
+  std::unique_ptr<unixSocketType> unixPtr;
+
+public:
+  /* Creates an unconnected socket. sslContext is only used by tls. */
+  ClientStream(clientTransport, boost::asio::io_context &,
+               boost::asio::ssl::context *sslContext);
+  ~ClientStream();
+  clientTransport getTransport();
+  // the TLS stream, nullptr for the other transports
+  tlsStreamType *tls();
+  // the TCP socket under TLS or the plain one, nullptr for local
+  boost::asio::ip::tcp::socket *tcpSocket();
+  unixSocketType *unixSocket();
+  bool isOpen();
+  /* Closes the socket without a TLS close_notify. The session stays
+   * resumable.
+   */
+  void close();
+  /* Returns 0 if the peer has neither closed the socket nor sent
+   * unsolicited data. Does not block.
+   */
+  int peekIdle();
+
+  // Beast stream concepts
+  executor_type get_executor();
+  template <class MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence &buffers) {
+    boost::system::error_code ec;
+    std::size_t len = read_some(buffers, ec);
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+    return len;
+  }
+  template <class MutableBufferSequence>
+  std::size_t read_some(const MutableBufferSequence &buffers,
+                        boost::system::error_code &ec) {
+    if (tlsPtr) {
+      return tlsPtr->read_some(buffers, ec);
+    }
+    if (unixPtr) {
+      return unixPtr->read_some(buffers, ec);
+    }
+    return tcpPtr->read_some(buffers, ec);
+  }
+  template <class ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence &buffers) {
+    boost::system::error_code ec;
+    std::size_t len = write_some(buffers, ec);
+    if (ec) {
+      throw boost::system::system_error(ec);
+    }
+    return len;
+  }
+  template <class ConstBufferSequence>
+  std::size_t write_some(const ConstBufferSequence &buffers,
+                         boost::system::error_code &ec) {
+    if (tlsPtr) {
+      return tlsPtr->write_some(buffers, ec);
+    }
+    if (unixPtr) {
+      return unixPtr->write_some(buffers, ec);
+    }
+    return tcpPtr->write_some(buffers, ec);
+  }
+  template <class MutableBufferSequence, class ReadHandler>
+  BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(ReadHandler,
+                                     void(boost::system::error_code,
+                                          std::size_t))
+  async_read_some(const MutableBufferSequence &buffers,
+                  ReadHandler &&handler) {
+    return boost::asio::async_initiate<
+        ReadHandler, void(boost::system::error_code, std::size_t)>(
+        [this](auto completionHandler, const MutableBufferSequence &buffers) {
+          if (tlsPtr) {
+            tlsPtr->async_read_some(buffers, std::move(completionHandler));
+          } else if (unixPtr) {
+            unixPtr->async_read_some(buffers, std::move(completionHandler));
+          } else {
+            tcpPtr->async_read_some(buffers, std::move(completionHandler));
+          }
+        },
+        handler, buffers);
+  }
+  template <class ConstBufferSequence, class WriteHandler>
+  BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(WriteHandler,
+                                     void(boost::system::error_code,
+                                          std::size_t))
+  async_write_some(const ConstBufferSequence &buffers,
+                   WriteHandler &&handler) {
+    return boost::asio::async_initiate<
+        WriteHandler, void(boost::system::error_code, std::size_t)>(
+        [this](auto completionHandler, const ConstBufferSequence &buffers) {
+          if (tlsPtr) {
+            tlsPtr->async_write_some(buffers, std::move(completionHandler));
+          } else if (unixPtr) {
+            unixPtr->async_write_some(buffers, std::move(completionHandler));
+          } else {
+            tcpPtr->async_write_some(buffers, std::move(completionHandler));
+          }
+        },
+        handler, buffers);
+  }
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_STREAM_H
@@ -0,0 +1,460 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ClientUpstream.hpp"
+#include "Client.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ClientUpstream::ClientUpstream() { transport = clientTransport::tcp; }
+ClientUpstream::~ClientUpstream() {}
+
+int ClientUpstream::parse(const std::string &url) {
+  if (url.rfind("unix:", 0) == 0) {
+    transport = clientTransport::local;
+    unixSocketPath = url.substr(5);
+    host = hostHeader = "localhost";
+    poolKey = "unix:" + unixSocketPath;
+    return unixSocketPath.empty() ? -1 : 0;
+  }
+  std::size_t schemeEnd = url.find("://");
+  if (schemeEnd == std::string::npos) {
+    return -1;
+  }
+  std::string scheme = url.substr(0, schemeEnd);
+  if (scheme == "http") {
+    transport = clientTransport::tcp;
+    port = "80";
+  } else if (scheme == "https") {
+    transport = clientTransport::tls;
+    port = "443";
+  } else {
+    return -1;
+  }
+  std::size_t authorityStart = schemeEnd + 3;
+  std::size_t authorityEnd = url.find('/', authorityStart);
+  hostHeader = url.substr(authorityStart, authorityEnd == std::string::npos
+                                              ? std::string::npos
+                                              : authorityEnd - authorityStart);
+  // an IPv6 literal is bracketed
+  std::size_t hostEnd = hostHeader.rfind(']');
+  std::size_t portStart = hostHeader.find(
+      ':', hostEnd == std::string::npos ? 0 : hostEnd);
+  host = hostHeader.substr(0, portStart);
+  if (portStart != std::string::npos) {
+    port = hostHeader.substr(portStart + 1);
+  }
+  if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  poolKey = scheme + "://" + host + ":" + port;
+  if (authorityEnd != std::string::npos) {
+    pathPrefix = url.substr(authorityEnd,
+                            url.find_first_of("?#", authorityEnd) -
+                                authorityEnd);
+    while (!pathPrefix.empty() && pathPrefix.back() == '/') {
+      pathPrefix.pop_back();
+    }
+  }
+  return host.empty() || port.empty() ? -1 : 0;
+}
+
+std::string ClientUpstream::getOrigin() {
+  switch (transport) {
+  case clientTransport::local:
+    return "unix:" + unixSocketPath;
+  case clientTransport::tls:
+    return "https://" + hostHeader;
+  default:
+    return "http://" + hostHeader;
+  }
+}
+
+ClientUpstreamLease::ClientUpstreamLease(
+    std::shared_ptr<ClientUpstreamGroup> groupPtr_, std::size_t index_,
+    std::shared_ptr<ClientUpstream> upstreamPtr_)
+    : groupPtr(groupPtr_), index(index_), upstreamPtr(upstreamPtr_) {}
+
+ClientUpstreamLease::~ClientUpstreamLease() { groupPtr->release(index); }
+
+void ClientUpstreamLease::addSample(std::chrono::microseconds latency,
+                                    bool failFlag) {
+  groupPtr->addSample(index, latency, failFlag);
+}
+
+ClientUpstreamGroup::ClientUpstreamGroup()
+    : randomEngine(std::random_device{}()) {
+  balance = upstreamBalanceType::p2c;
+  healthCheckInterval = std::chrono::milliseconds(5000);
+  healthCheckTimeout = std::chrono::milliseconds(2000);
+  healthyThreshold = 1;
+  unhealthyThreshold = 2;
+  ejectConsecutiveErrors = 5;
+  ejectLatencyFactor = 3;
+  ejectTime = std::chrono::milliseconds(30000);
+  ejectMaxPercent = 50;
+  nextIndex = 0;
+  ejectTotalNum = 0;
+}
+ClientUpstreamGroup::~ClientUpstreamGroup() {}
+
+int ClientUpstreamGroup::extractSettings(const rapidjson::Value &groupJson) {
+  if (!groupJson.IsObject()) {
+    logStatus("::ClientUpstreamGroup::extractSettings",
+              "ERROR: upstream group " + name + " is not an object.");
+    return -1;
+  }
+  JsonImpl json;
+  if (groupJson.HasMember("endpoints") && groupJson["endpoints"].IsArray()) {
+    for (auto &urlJson : groupJson["endpoints"].GetArray()) {
+      if (urlJson.IsString()) {
+        addEndpoint(urlJson.GetString());
+      }
+    }
+  }
+  auto balanceOpt = json.getMemberString(groupJson, "balance");
+  if (balanceOpt) {
+    if (*balanceOpt == "roundRobin") {
+      balance = upstreamBalanceType::roundRobin;
+    } else if (*balanceOpt == "leastOutstanding") {
+      balance = upstreamBalanceType::leastOutstanding;
+    } else if (*balanceOpt == "p2c") {
+      balance = upstreamBalanceType::p2c;
+    } else {
+      logStatus("::ClientUpstreamGroup::extractSettings",
+                "WARNING: unknown balance " + *balanceOpt + ", using p2c.");
+    }
+  }
+  auto healthCheckPathOpt = json.getMemberString(groupJson, "healthCheckPath");
+  if (healthCheckPathOpt) {
+    healthCheckPath = *healthCheckPathOpt;
+  }
+  auto healthCheckIntervalOpt =
+      json.getMemberInt(groupJson, "healthCheckInterval");
+  if (healthCheckIntervalOpt) {
+    healthCheckInterval =
+        std::chrono::milliseconds(std::max<int>(100, *healthCheckIntervalOpt));
+  }
+  auto healthCheckTimeoutOpt =
+      json.getMemberInt(groupJson, "healthCheckTimeout");
+  if (healthCheckTimeoutOpt) {
+    healthCheckTimeout =
+        std::chrono::milliseconds(std::max<int>(1, *healthCheckTimeoutOpt));
+  }
+  auto healthyThresholdOpt = json.getMemberInt(groupJson, "healthyThreshold");
+  if (healthyThresholdOpt) {
+    healthyThreshold = std::max<int>(1, *healthyThresholdOpt);
+  }
+  auto unhealthyThresholdOpt =
+      json.getMemberInt(groupJson, "unhealthyThreshold");
+  if (unhealthyThresholdOpt) {
+    unhealthyThreshold = std::max<int>(1, *unhealthyThresholdOpt);
+  }
+  auto ejectConsecutiveErrorsOpt =
+      json.getMemberInt(groupJson, "ejectConsecutiveErrors");
+  if (ejectConsecutiveErrorsOpt) {
+    // 0 disables
+    ejectConsecutiveErrors = std::max<int>(0, *ejectConsecutiveErrorsOpt);
+  }
+  auto ejectLatencyFactorOpt =
+      json.getMemberInt(groupJson, "ejectLatencyFactor");
+  if (ejectLatencyFactorOpt) {
+    ejectLatencyFactor = std::max<int>(0, *ejectLatencyFactorOpt);
+  }
+  auto ejectTimeOpt = json.getMemberInt(groupJson, "ejectTime");
+  if (ejectTimeOpt) {
+    ejectTime = std::chrono::milliseconds(std::max<int>(1, *ejectTimeOpt));
+  }
+  auto ejectMaxPercentOpt = json.getMemberInt(groupJson, "ejectMaxPercent");
+  if (ejectMaxPercentOpt) {
+    ejectMaxPercent = std::clamp<int>(*ejectMaxPercentOpt, 0, 100);
+  }
+  return 0;
+}
+
+int ClientUpstreamGroup::addEndpoint(const std::string &url) {
+  auto upstreamPtr = std::make_shared<ClientUpstream>();
+  upstreamPtr->name = name;
+  if (upstreamPtr->parse(url) < 0) {
+    logStatus("::ClientUpstreamGroup::addEndpoint",
+              "ERROR: invalid endpoint URL " + url);
+    return -1;
+  }
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  endpointList.emplace_back();
+  endpointList.back().upstreamPtr = upstreamPtr;
+  return 0;
+}
+
+std::vector<std::size_t> ClientUpstreamGroup::getAvailable() {
+  auto now = std::chrono::steady_clock::now();
+  std::vector<std::size_t> availableList;
+  for (std::size_t i = 0; i < endpointList.size(); i++) {
+    endpointState &endpoint = endpointList[i];
+    if (endpoint.ejectedFlag && now >= endpoint.ejectUntil) {
+      // back on probation, its old latencies no longer count
+      endpoint.ejectedFlag = false;
+      endpoint.consecutiveErrorNum = 0;
+      endpoint.sampleNum = 0;
+    }
+    if (!endpoint.ejectedFlag && endpoint.healthyFlag) {
+      availableList.push_back(i);
+    }
+  }
+  if (availableList.empty()) {
+    // failing every request would be worse than trying the bad endpoints
+    for (std::size_t i = 0; i < endpointList.size(); i++) {
+      availableList.push_back(i);
+    }
+  }
+  return availableList;
+}
+
+std::shared_ptr<ClientUpstreamLease> ClientUpstreamGroup::pick() {
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  if (endpointList.empty()) {
+    return nullptr;
+  }
+  std::vector<std::size_t> availableList = getAvailable();
+  const std::size_t availableNum = availableList.size();
+  std::size_t index = availableList[nextIndex++ % availableNum];
+  if (balance == upstreamBalanceType::leastOutstanding) {
+    // the scan starts at the round-robin choice so ties are spread
+    for (std::size_t i = 0; i < availableNum; i++) {
+      std::size_t candidate =
+          availableList[(nextIndex + i) % availableNum];
+      if (endpointList[candidate].outstandingNum <
+          endpointList[index].outstandingNum) {
+        index = candidate;
+      }
+    }
+  } else if (balance == upstreamBalanceType::p2c && availableNum > 1) {
+    std::uniform_int_distribution<std::size_t> distribution(0,
+                                                            availableNum - 1);
+    std::size_t first = distribution(randomEngine);
+    std::size_t second = distribution(randomEngine);
+    if (second == first) {
+      second = (first + 1) % availableNum;
+    }
+    const endpointState &a = endpointList[availableList[first]];
+    const endpointState &b = endpointList[availableList[second]];
+    // fewer requests in flight wins, then the lower latency
+    bool firstFlag = a.outstandingNum != b.outstandingNum
+                         ? a.outstandingNum < b.outstandingNum
+                         : a.latencyAverage <= b.latencyAverage;
+    index = availableList[firstFlag ? first : second];
+  }
+  endpointState &endpoint = endpointList[index];
+  endpoint.outstandingNum++;
+  endpoint.requestNum++;
+  return std::make_shared<ClientUpstreamLease>(shared_from_this(), index,
+                                               endpoint.upstreamPtr);
+}
+
+void ClientUpstreamGroup::release(std::size_t index) {
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  endpointList[index].outstandingNum--;
+}
+
+void ClientUpstreamGroup::addSample(std::size_t index,
+                                    std::chrono::microseconds latency,
+                                    bool failFlag) {
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  endpointState &endpoint = endpointList[index];
+  if (endpoint.ejectedFlag) {
+    // a request picked before the ejection
+    return;
+  }
+  if (failFlag) {
+    endpoint.errorNum++;
+    endpoint.consecutiveErrorNum++;
+    if (ejectConsecutiveErrors > 0 &&
+        endpoint.consecutiveErrorNum >= ejectConsecutiveErrors) {
+      eject(index, std::to_string(endpoint.consecutiveErrorNum) +
+                       " consecutive errors");
+    }
+    return;
+  }
+  endpoint.consecutiveErrorNum = 0;
+  const double latencyNum = static_cast<double>(latency.count());
+  endpoint.latencyAverage = endpoint.sampleNum == 0
+                                ? latencyNum
+                                : 0.8 * endpoint.latencyAverage +
+                                      0.2 * latencyNum;
+  endpoint.sampleNum++;
+  // a few samples of each endpoint are needed before comparing them
+  const uint64_t minSampleNum = 20;
+  if (ejectLatencyFactor <= 0 || endpoint.sampleNum < minSampleNum) {
+    return;
+  }
+  std::vector<double> latencyList;
+  for (std::size_t i = 0; i < endpointList.size(); i++) {
+    if (i != index && !endpointList[i].ejectedFlag &&
+        endpointList[i].sampleNum >= minSampleNum) {
+      latencyList.push_back(endpointList[i].latencyAverage);
+    }
+  }
+  if (latencyList.empty()) {
+    return;
+  }
+  auto middle = latencyList.begin() + latencyList.size() / 2;
+  std::nth_element(latencyList.begin(), middle, latencyList.end());
+  if (endpoint.latencyAverage > ejectLatencyFactor * *middle) {
+    eject(index, "latency " +
+                     std::to_string(static_cast<uint64_t>(
+                         endpoint.latencyAverage)) +
+                     "us against a median of " +
+                     std::to_string(static_cast<uint64_t>(*middle)) + "us");
+  }
+}
+
+void ClientUpstreamGroup::eject(std::size_t index, const std::string &reason) {
+  std::size_t ejectedNum = 0;
+  for (auto &endpoint : endpointList) {
+    ejectedNum += endpoint.ejectedFlag ? 1 : 0;
+  }
+  if ((ejectedNum + 1) * 100 >
+      static_cast<std::size_t>(ejectMaxPercent) * endpointList.size()) {
+    return;
+  }
+  endpointState &endpoint = endpointList[index];
+  endpoint.ejectedFlag = true;
+  endpoint.ejectNum++;
+  endpoint.ejectUntil = std::chrono::steady_clock::now() +
+                        ejectTime * std::min(endpoint.ejectNum, 10);
+  endpoint.consecutiveErrorNum = 0;
+  ejectTotalNum++;
+  logStatus("::ClientUpstreamGroup::eject",
+            name + " ejected " + endpoint.upstreamPtr->getOrigin() + ", " +
+                reason);
+}
+
+int ClientUpstreamGroup::startHealthCheck(
+    std::weak_ptr<ClientState> clientStateWeak,
+    boost::asio::io_context &ioContext) {
+  if (healthCheckPath.empty()) {
+    return 0;
+  }
+  checkTimerPtr = std::make_unique<boost::asio::steady_timer>(ioContext);
+  runHealthCheck(clientStateWeak);
+  return 0;
+}
+
+void ClientUpstreamGroup::runHealthCheck(
+    std::weak_ptr<ClientState> clientStateWeak) {
+  std::shared_ptr<ClientState> clientState = clientStateWeak.lock();
+  if (!clientState) {
+    return;
+  }
+  std::vector<std::shared_ptr<ClientUpstream>> upstreamList;
+  {
+    const std::lock_guard<std::mutex> lock(groupMutex);
+    for (auto &endpoint : endpointList) {
+      upstreamList.push_back(endpoint.upstreamPtr);
+    }
+  }
+  std::weak_ptr<ClientUpstreamGroup> groupWeak = shared_from_this();
+  for (std::size_t i = 0; i < upstreamList.size(); i++) {
+    ClientUpstream &upstream = *upstreamList[i];
+    auto checkPtr = std::make_shared<ClientImpl>();
+    checkPtr->setSettingsDoc(clientState->getSettingsDoc());
+    checkPtr->setClientState(clientState);
+    if (upstream.transport == clientTransport::local) {
+      checkPtr->setURL("http://localhost" + healthCheckPath);
+      checkPtr->setUnixSocket(upstream.unixSocketPath);
+    } else {
+      checkPtr->setURL(upstream.getOrigin() + upstream.pathPrefix +
+                       healthCheckPath);
+    }
+    // the check must reach the endpoint, not the cache or another request
+    checkPtr->setHeader({{"Cache-Control", "no-store"}});
+    checkPtr->setTimeout(static_cast<int>(healthCheckTimeout.count()));
+    checkPtr->setRetries(0);
+    checkPtr->setCoalesce(false);
+    // the callback keeps the check alive, endAsync drops it once it ran
+    checkPtr->endAsync([groupWeak, i, checkPtr](int rc) {
+      auto groupPtr = groupWeak.lock();
+      if (!groupPtr) {
+        return;
+      }
+      const int status = checkPtr->getResponseStatus();
+      groupPtr->addCheckResult(i, rc == 0 && status >= 200 && status < 400);
+    });
+  }
+  checkTimerPtr->expires_after(healthCheckInterval);
+  checkTimerPtr->async_wait(
+      [groupWeak, clientStateWeak](boost::system::error_code ec) {
+        auto groupPtr = groupWeak.lock();
+        if (ec || !groupPtr) {
+          return;
+        }
+        groupPtr->runHealthCheck(clientStateWeak);
+      });
+}
+
+void ClientUpstreamGroup::addCheckResult(std::size_t index, bool okFlag) {
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  endpointState &endpoint = endpointList[index];
+  if (okFlag) {
+    endpoint.checkFailNum = 0;
+    endpoint.checkOkNum++;
+    if (!endpoint.healthyFlag && endpoint.checkOkNum >= healthyThreshold) {
+      endpoint.healthyFlag = true;
+      logStatus("::ClientUpstreamGroup::addCheckResult",
+                name + " " + endpoint.upstreamPtr->getOrigin() + " is healthy");
+    }
+    return;
+  }
+  endpoint.checkOkNum = 0;
+  endpoint.checkFailNum++;
+  if (endpoint.healthyFlag && endpoint.checkFailNum >= unhealthyThreshold) {
+    endpoint.healthyFlag = false;
+    logStatus("::ClientUpstreamGroup::addCheckResult",
+              name + " " + endpoint.upstreamPtr->getOrigin() +
+                  " failed its health check");
+  }
+}
+
+int ClientUpstreamGroup::getStats(
+    rapidjson::Value &statsValue,
+    rapidjson::Document::AllocatorType &allocator) {
+  const std::lock_guard<std::mutex> lock(groupMutex);
+  statsValue.SetObject();
+  statsValue.AddMember("ejections", ejectTotalNum, allocator);
+  rapidjson::Value endpointsValue;
+  endpointsValue.SetArray();
+  auto now = std::chrono::steady_clock::now();
+  for (auto &endpoint : endpointList) {
+    rapidjson::Value endpointValue;
+    endpointValue.SetObject();
+    endpointValue.AddMember(
+        "url",
+        rapidjson::Value(endpoint.upstreamPtr->getOrigin().c_str(), allocator),
+        allocator);
+    endpointValue.AddMember("outstanding", endpoint.outstandingNum, allocator);
+    endpointValue.AddMember("requests", endpoint.requestNum, allocator);
+    endpointValue.AddMember("errors", endpoint.errorNum, allocator);
+    endpointValue.AddMember(
+        "latencyMs", endpoint.latencyAverage / 1000.0, allocator);
+    endpointValue.AddMember("healthy", endpoint.healthyFlag, allocator);
+    endpointValue.AddMember(
+        "ejected", endpoint.ejectedFlag && now < endpoint.ejectUntil,
+        allocator);
+    endpointsValue.PushBack(endpointValue, allocator);
+  }
+  statsValue.AddMember("endpoints", endpointsValue, allocator);
+  return 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
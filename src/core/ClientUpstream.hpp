@@ -0,0 +1,168 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_CLIENT_UPSTREAM_H
+#define BOOKFILER_MODULE_HTTP_HTTP_CLIENT_UPSTREAM_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// Local Project
+#include "ClientStream.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+class ClientState;
+class ClientUpstreamGroup;
+
+/* A server requests can be sent to, parsed from "http://host:port/path",
+ * "https://host:port/path" or "unix:/path"
+ */
+class ClientUpstream {
+public:
+  ClientUpstream();
+  ~ClientUpstream();
+  std::string name;
+  clientTransport transport;
+  std::string host, port, unixSocketPath;
+  // "host" or "host:port" when the port is not the scheme default
+  std::string hostHeader;
+  // same key as ClientImpl so every request to it shares pooled connections
+  std::string poolKey;
+  // path of the URL without a trailing slash, put in front of request paths
+  std::string pathPrefix;
+  /* Returns -1 if the URL has an unknown scheme or no host */
+  int parse(const std::string &url);
+  // "scheme://hostHeader" or "unix:path"
+  std::string getOrigin();
+};
+
+/* A request counted as outstanding on an endpoint of a group until the
+ * lease is destroyed
+ */
+class ClientUpstreamLease {
+private:
+  std::shared_ptr<ClientUpstreamGroup> groupPtr;
+  std::size_t index;
+
+public:
+  ClientUpstreamLease(std::shared_ptr<ClientUpstreamGroup>, std::size_t index,
+                      std::shared_ptr<ClientUpstream>);
+  ~ClientUpstreamLease();
+  std::shared_ptr<ClientUpstream> upstreamPtr;
+  /* Reports the outcome of one attempt on the endpoint. failFlag is set for
+   * connection errors and 5xx responses.
+   */
+  void addSample(std::chrono::microseconds latency, bool failFlag);
+};
+
+enum class upstreamBalanceType { roundRobin, leastOutstanding, p2c };
+
+/* Several endpoints serving the same content. Requests are spread with
+ * round-robin, least outstanding requests or power of two choices. An
+ * endpoint that fails active health checks, fails ejectConsecutiveErrors
+ * requests in a row or is ejectLatencyFactor times slower than the median
+ * of the others is skipped for a while. If no endpoint is left the load
+ * goes to all of them.
+ */
+class ClientUpstreamGroup
+    : public std::enable_shared_from_this<ClientUpstreamGroup> {
+private:
+  class endpointState {
+  public:
+    std::shared_ptr<ClientUpstream> upstreamPtr;
+    int outstandingNum = 0;
+    int consecutiveErrorNum = 0;
+    // exponentially weighted, in microseconds
+    double latencyAverage = 0;
+    uint64_t sampleNum = 0;
+    bool ejectedFlag = false;
+    int ejectNum = 0;
+    std::chrono::steady_clock::time_point ejectUntil;
+    bool healthyFlag = true;
+    int checkOkNum = 0, checkFailNum = 0;
+    uint64_t requestNum = 0, errorNum = 0;
+  };
+  std::mutex groupMutex;
+  std::vector<endpointState> endpointList;
+  std::size_t nextIndex;
+  std::mt19937 randomEngine;
+  std::unique_ptr<boost::asio::steady_timer> checkTimerPtr;
+  uint64_t ejectTotalNum;
+  /* Ejects the endpoint unless ejectMaxPercent of the group already is */
+  void eject(std::size_t index, const std::string &reason);
+  /* Endpoints neither ejected nor failing health checks */
+  std::vector<std::size_t> getAvailable();
+  void runHealthCheck(std::weak_ptr<ClientState>);
+  void addCheckResult(std::size_t index, bool okFlag);
+
+public:
+  ClientUpstreamGroup();
+  ~ClientUpstreamGroup();
+  std::string name;
+  upstreamBalanceType balance;
+  // GET requests to healthCheckPath, none if the path is empty
+  std::string healthCheckPath;
+  std::chrono::milliseconds healthCheckInterval, healthCheckTimeout;
+  int healthyThreshold, unhealthyThreshold;
+  int ejectConsecutiveErrors;
+  // 0 disables latency ejection
+  double ejectLatencyFactor;
+  // times the ejections of the endpoint so far, at most 10 times
+  std::chrono::milliseconds ejectTime;
+  int ejectMaxPercent;
+  // the group's JSON, a settings push with the same JSON keeps the group
+  std::string settingsStr;
+  /* Reads the "endpoints" URL array and the balancing, health check and
+   * ejection settings of a group
+   */
+  int extractSettings(const rapidjson::Value &);
+  int addEndpoint(const std::string &url);
+  /* Chooses an endpoint, nullptr if the group has none */
+  std::shared_ptr<ClientUpstreamLease> pick();
+  /* Outcome of a request on the endpoint at index */
+  void addSample(std::size_t index, std::chrono::microseconds latency,
+                 bool failFlag);
+  void release(std::size_t index);
+  /* Checks every endpoint each healthCheckInterval on the client threads.
+   * Stops once the group or the client state is gone.
+   */
+  int startHealthCheck(std::weak_ptr<ClientState>, boost::asio::io_context &);
+  int getStats(rapidjson::Value &, rapidjson::Document::AllocatorType &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_CLIENT_UPSTREAM_H
@@ -15,16 +15,22 @@
 namespace bookfiler {
 namespace HTTP {
 
-UserAgentImpl::UserAgentImpl() {
-  uap_cpp::UserAgentParser userAgentParser("resources/regexes.yaml");
-  userAgent = userAgentParser.parse(
-      "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, "
-      "like Gecko) Chrome/86.0.4240.183 Safari/537.36");
-}
+UserAgentImpl::UserAgentImpl() { parsedFlag = false; }
 
 UserAgentImpl::~UserAgentImpl() {}
 
-std::string UserAgentImpl::getBrowser() { return userAgent.browser.family; }
+std::string UserAgentImpl::getBrowser() {
+  if (!parsedFlag) {
+    // loading the regexes takes long, so it is done once and only if needed
+    static const uap_cpp::UserAgentParser userAgentParser(
+        "resources/regexes.yaml");
+    userAgent = userAgentParser.parse(
+        "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, "
+        "like Gecko) Chrome/86.0.4240.183 Safari/537.36");
+    parsedFlag = true;
+  }
+  return userAgent.browser.family;
+}
 
 } // namespace HTTP
 } // namespace bookfiler
@@ -35,6 +35,7 @@ namespace HTTP {
 class UserAgentImpl {
 private:
   uap_cpp::UserAgent userAgent;
+  bool parsedFlag;
 
 public:
   UserAgentImpl();
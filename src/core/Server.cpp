@@ -34,8 +34,20 @@ int ServerImpl::setSettingsDoc(std::shared_ptr<rapidjson::Value> settingsDoc_) {
   return 0;
 }
 
+int ServerImpl::setClientState(std::shared_ptr<ClientState> clientState_) {
+  clientState = clientState_;
+  return 0;
+}
+
 int ServerImpl::run() {
   extractSettings();
+  if (!clientState) {
+    clientState = std::make_shared<ClientState>();
+    clientState->setSettingsDoc(settingsDoc);
+    clientState->extractSettings();
+    clientState->init();
+  }
+  serverState->proxyPtr->setClientState(clientState);
   std::stringstream ss;
   auto hardwareThreadsNum = std::thread::hardware_concurrency();
   ss << "threadsNum: " << serverState->threadsNum
@@ -104,6 +116,62 @@ int ServerImpl::extractSettings() {
     serverState->threadsNum = *threadsNumOpt;
   }
 
+  auto headerLimitOpt = json.getMemberInt(ServerStateJson, "headerLimit");
+  if (headerLimitOpt) {
+    serverState->headerLimit =
+        static_cast<std::uint32_t>(std::max<int>(1024, *headerLimitOpt));
+  }
+  auto headerCountLimitOpt =
+      json.getMemberInt(ServerStateJson, "headerCountLimit");
+  if (headerCountLimitOpt) {
+    serverState->headerCountLimit =
+        static_cast<std::size_t>(std::max<int>(1, *headerCountLimitOpt));
+  }
+  auto bodyLimitOpt = json.getMemberInt(ServerStateJson, "bodyLimit");
+  if (bodyLimitOpt) {
+    serverState->bodyLimit =
+        static_cast<std::uint64_t>(std::max<int>(0, *bodyLimitOpt));
+  }
+  auto bufferLimitOpt = json.getMemberInt(ServerStateJson, "bufferLimit");
+  if (bufferLimitOpt) {
+    serverState->bufferLimit =
+        static_cast<std::size_t>(std::max<int>(1024, *bufferLimitOpt));
+  }
+  auto idleBufferSizeOpt = json.getMemberInt(ServerStateJson, "idleBufferSize");
+  if (idleBufferSizeOpt) {
+    serverState->idleBufferSize =
+        static_cast<std::size_t>(std::max<int>(0, *idleBufferSizeOpt));
+  }
+  // a whole header has to fit in the buffer
+  serverState->bufferLimit =
+      std::max<std::size_t>(serverState->bufferLimit, serverState->headerLimit);
+
+  auto rateLimitPerSecondOpt =
+      json.getMemberInt(ServerStateJson, "rateLimitPerSecond");
+  if (rateLimitPerSecondOpt) {
+    int perSecond = std::max<int>(0, *rateLimitPerSecondOpt);
+    int burst = perSecond;
+    auto rateLimitBurstOpt =
+        json.getMemberInt(ServerStateJson, "rateLimitBurst");
+    if (rateLimitBurstOpt) {
+      burst = std::max<int>(1, *rateLimitBurstOpt);
+    }
+    serverState->rateLimitPtr->setLimit(perSecond, burst);
+  }
+
+  auto cacheMaxEntriesOpt =
+      json.getMemberInt(ServerStateJson, "cacheMaxEntries");
+  if (cacheMaxEntriesOpt) {
+    serverState->cachePtr->maxEntries =
+        static_cast<std::size_t>(std::max<int>(0, *cacheMaxEntriesOpt));
+  }
+
+  if (ServerStateJson.HasMember("socket")) {
+    serverState->socketOptionsPtr->extractSettings(ServerStateJson["socket"]);
+  }
+
+  serverState->proxyPtr->extractSettings(ServerStateJson);
+
   serverState->address = boost::asio::ip::make_address(serverState->addressStr);
   serverState->port = static_cast<unsigned short>(serverState->portInt);
   serverState->threadsNum = std::max<int>(1, serverState->threadsNum);
@@ -132,12 +200,16 @@ int ServerImpl::useCertificate(
     return -1;
   }
 
-  std::shared_ptr<std::string> dhStr = certImplPtr->getDhStr();
-  if (!dhStr) {
-    std::cout << moduleCode
-              << "::ServerImpl::useCertificate ERROR:\nCould not get cert."
-              << std::endl;
-    return -1;
+  // ECDSA and Ed25519 certificates come without DH parameters
+  std::shared_ptr<std::string> dhStr;
+  if (certImplPtr->dhKey) {
+    dhStr = certImplPtr->getDhStr();
+    if (!dhStr) {
+      std::cout << moduleCode
+                << "::ServerImpl::useCertificate ERROR:\nCould not get cert."
+                << std::endl;
+      return -1;
+    }
   }
 
   sslContext->set_password_callback(
@@ -156,7 +228,10 @@ int ServerImpl::useCertificate(
       boost::asio::buffer(privateKeyStr->data(), privateKeyStr->size()),
       boost::asio::ssl::context::file_format::pem);
 
-  sslContext->use_tmp_dh(boost::asio::buffer(dhStr->data(), dhStr->size()));
+  if (dhStr) {
+    sslContext->use_tmp_dh(
+        boost::asio::buffer(dhStr->data(), dhStr->size()));
+  }
 
   return 0;
 }
@@ -164,14 +239,24 @@ int ServerImpl::useCertificate(
 int ServerImpl::route(std::map<std::string, routeVariantTypeExternal> map_) {
   logStatus("::ServerImpl::route", "START");
   std::shared_ptr<routeFunctionTypeExternal> routeFunction;
-  std::string method, path;
+  std::string method, path, proxy;
   int priority = 10;
+  int rateLimitPerSecond = 0, rateLimitBurst = 0, cacheTtl = 0, etag = 0;
+  std::string cacheVary;
   method = "GET";
   path = "*";
   for (auto val : map_) {
     if (int *val_ = std::get_if<int>(&val.second)) {
       if (val.first == "priority") {
         priority = *val_;
+      } else if (val.first == "rateLimitPerSecond") {
+        rateLimitPerSecond = *val_;
+      } else if (val.first == "rateLimitBurst") {
+        rateLimitBurst = *val_;
+      } else if (val.first == "cacheTtl") {
+        cacheTtl = *val_;
+      } else if (val.first == "etag") {
+        etag = *val_;
       }
     } else if (double *val_ = std::get_if<double>(&val.second)) {
     } else if (std::string *val_ = std::get_if<std::string>(&val.second)) {
@@ -179,6 +264,10 @@ int ServerImpl::route(std::map<std::string, routeVariantTypeExternal> map_) {
         method = *val_;
       } else if (val.first == "path") {
         path = *val_;
+      } else if (val.first == "proxy") {
+        proxy = *val_;
+      } else if (val.first == "cacheVary") {
+        cacheVary = *val_;
       }
     } else if (routeFunctionTypeExternal *val_ =
                    std::get_if<routeFunctionTypeExternal>(&val.second)) {
@@ -186,8 +275,43 @@ int ServerImpl::route(std::map<std::string, routeVariantTypeExternal> map_) {
           std::make_shared<routeFunctionTypeExternal>(std::move(*val_));
     }
   }
+  if (rateLimitPerSecond > 0) {
+    // the burst defaults to one second of requests
+    serverState->rateLimitPtr->routeAdd(
+        method, path, rateLimitPerSecond,
+        rateLimitBurst > 0 ? rateLimitBurst : rateLimitPerSecond);
+  }
+  if (!proxy.empty()) {
+    // a URL is its own upstream, anything else names one from the settings
+    if (proxy.find("://") != std::string::npos ||
+        proxy.rfind("unix:", 0) == 0) {
+      serverState->proxyPtr->addUpstream(proxy, proxy);
+    }
+    return routePtr->proxyAdd(method, path, priority, proxy);
+  }
+  if (!routeFunction) {
+    logStatus("::ServerImpl::route", "ERROR: route has no function or proxy");
+    return -1;
+  }
   if (method == "GET") {
     routePtr->getAdd(path, priority, *routeFunction);
+    if (cacheTtl > 0) {
+      // a comma separated list of header names
+      std::vector<std::string> varyList;
+      std::stringstream varyStream(cacheVary);
+      std::string name;
+      while (std::getline(varyStream, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (!name.empty()) {
+          varyList.push_back(name);
+        }
+      }
+      routePtr->cacheAdd(path, std::chrono::milliseconds(cacheTtl), varyList);
+    }
+    if (etag) {
+      routePtr->etagAdd(path);
+    }
   } else if (method == "POST") {
     routePtr->postAdd(path, priority, *routeFunction);
   } else if (method == "*") {
@@ -44,6 +44,7 @@
 #include <boost/config.hpp>
 
 // Local Project
+#include "ClientState.hpp"
 #include "certificateManager.hpp"
 #include "ServerListener.hpp"
 
@@ -68,14 +69,20 @@ private:
   std::shared_ptr<Listener> listener;
   std::vector<std::thread> threadList;
   std::shared_ptr<RouteImpl> routePtr;
+  // upstream connections of proxy routes come from its pool
+  std::shared_ptr<ClientState> clientState;
 
 public:
   ServerImpl();
   ~ServerImpl();
   int setSettingsDoc(std::shared_ptr<rapidjson::Value>);
+  int setClientState(std::shared_ptr<ClientState>);
   int run();
   void runIoContext();
   int extractSettings();
+  /* Each key type has its own slot in the SSL context, so an RSA and an
+   * ECDSA certificate can both be used and OpenSSL picks one per client
+   */
   int useCertificate(std::shared_ptr<bookfiler::certificate::Certificate>);
   int route(std::map<std::string, routeVariantTypeExternal> map_);
 };
@@ -0,0 +1,118 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+
+// Local Project
+#include "ServerCache.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ServerCache::ServerCache() { maxEntries = 1000; }
+ServerCache::~ServerCache() {}
+
+serverCacheResultType
+ServerCache::fetch(const std::string &key, std::chrono::milliseconds ttl,
+                   const std::function<serverCacheResultType()> &runFunction,
+                   boost::asio::yield_context yieldContext) {
+  for (;;) {
+    {
+      const std::lock_guard<std::mutex> lock(cacheMutex);
+      auto it = entryMap.find(key);
+      if (it != entryMap.end() &&
+          it->second.expireTime > std::chrono::steady_clock::now()) {
+        return {0, it->second.response};
+      }
+      if (flightMap.find(key) == flightMap.end()) {
+        flightMap.emplace(
+            key, std::vector<std::function<void(serverCacheResultType)>>());
+        break;
+      }
+    }
+
+    // wait on the coroutine's strand for the request running the function
+    serverCacheResultType result = boost::asio::async_initiate<
+        boost::asio::yield_context, void(serverCacheResultType)>(
+        [this, &key](auto handler) {
+          auto executor = boost::asio::get_associated_executor(handler);
+          auto waiter = [executor, handler](serverCacheResultType result_) {
+            boost::asio::post(executor, [handler, result_]() mutable {
+              handler(std::move(result_));
+            });
+          };
+          std::unique_lock<std::mutex> lock(cacheMutex);
+          auto it = flightMap.find(key);
+          if (it == flightMap.end()) {
+            // it finished in the meantime, look again
+            lock.unlock();
+            waiter({1, {}});
+            return;
+          }
+          it->second.push_back(std::move(waiter));
+        },
+        yieldContext);
+    if (result.first != 1) {
+      return result;
+    }
+  }
+
+  serverCacheResultType result;
+  try {
+    result = runFunction();
+  } catch (...) {
+    // the key must not stay in flight or later requests wait forever
+    finish(key, ttl, {-1, {}});
+    throw;
+  }
+  finish(key, ttl, result);
+  return result;
+}
+
+void ServerCache::finish(const std::string &key, std::chrono::milliseconds ttl,
+                         serverCacheResultType result) {
+  std::vector<std::function<void(serverCacheResultType)>> waiterList;
+  {
+    const std::lock_guard<std::mutex> lock(cacheMutex);
+    auto flightIt = flightMap.find(key);
+    if (flightIt != flightMap.end()) {
+      waiterList = std::move(flightIt->second);
+      flightMap.erase(flightIt);
+    }
+    if (result.first == 0 && result.second.headerPtr &&
+        result.second.bodyPtr && ttl.count() > 0) {
+      auto now = std::chrono::steady_clock::now();
+      if (entryMap.size() >= maxEntries) {
+        for (auto it = entryMap.begin(); it != entryMap.end();) {
+          if (it->second.expireTime <= now) {
+            it = entryMap.erase(it);
+          } else {
+            it++;
+          }
+        }
+      }
+      // every entry is fresh, the new one waits for room
+      if (entryMap.size() < maxEntries) {
+        entryMap[key] = entry{result.second, now + ttl};
+      }
+    }
+  }
+  for (auto &waiter : waiterList) {
+    waiter(result);
+  }
+}
+
+} // namespace HTTP
+} // namespace bookfiler
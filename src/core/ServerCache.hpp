@@ -0,0 +1,92 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_SERVER_CACHE_H
+#define BOOKFILER_MODULE_HTTP_HTTP_SERVER_CACHE_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/spawn.hpp>
+#include <boost/beast/http/message.hpp>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* The status and fields the route function set, without Content-Length,
+ * and the body it returned
+ */
+class ServerCacheResponse {
+public:
+  std::shared_ptr<const boost::beast::http::response_header<>> headerPtr;
+  std::shared_ptr<const std::string> bodyPtr;
+  // tag of the body, empty unless the route sends ETags on this status
+  std::string etag;
+};
+
+// the route function's result code and the response it returned
+using serverCacheResultType = std::pair<int, ServerCacheResponse>;
+
+/* Responses of GET routes kept for a few seconds. Headers and bodies are
+ * immutable and shared by every response written from them. A miss runs the
+ * route function once, requests for the same key that arrive meanwhile wait
+ * for its response instead of running it again.
+ */
+class ServerCache {
+private:
+  class entry {
+  public:
+    ServerCacheResponse response;
+    std::chrono::steady_clock::time_point expireTime;
+  };
+  std::mutex cacheMutex;
+  std::unordered_map<std::string, entry> entryMap;
+  // waiters of each key whose route function runs
+  std::unordered_map<std::string,
+                     std::vector<std::function<void(serverCacheResultType)>>>
+      flightMap;
+  void finish(const std::string &key, std::chrono::milliseconds ttl,
+              serverCacheResultType result);
+
+public:
+  ServerCache();
+  ~ServerCache();
+  std::size_t maxEntries;
+  /* Returns the cached response of the key, otherwise the result of
+   * runFunction. Only responses with result code 0 are cached for ttl, a
+   * response returned with result code 2 is only shared with the waiting
+   * requests. Result code 1 is reserved. When runFunction throws, the waiting
+   * requests get result code -1.
+   */
+  serverCacheResultType
+  fetch(const std::string &key, std::chrono::milliseconds ttl,
+        const std::function<serverCacheResultType()> &runFunction,
+        boost::asio::yield_context yieldContext);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_SERVER_CACHE_H
@@ -38,30 +38,116 @@ int Connection::run(net::yield_context yieldContext) {
     return -1;
   }
 
-  // This buffer is required to persist across reads
-  beast::flat_buffer buffer;
+  // This buffer is required to persist across reads, bounded so a client
+  // can not grow it past bufferLimit
+  beast::flat_buffer buffer(serverState->bufferLimit);
+  // forwarded to proxy upstreams
+  tcp::endpoint remoteEndpoint =
+      beast::get_lowest_layer(sslStream).socket().remote_endpoint(ec);
+  std::string clientAddress = remoteEndpoint.address().to_string();
 
   while (close) {
     int rc = 0;
     // Set the timeout.
     beast::get_lowest_layer(sslStream).expires_after(std::chrono::seconds(30));
 
-    // Read a request
-    requestBeastInternal reqBeast =
-        std::make_shared<http::request<http::string_body>>();
-    http::async_read(sslStream, buffer, *reqBeast, yieldContext[ec]);
-    std::stringstream ss;
-    ss << "http::async_read request\n" << *reqBeast << "\n";
-    logStatus("::ServerImpl::do_session", ss.str());
+    // an idle connection only keeps a small buffer after a large request
+    if (buffer.capacity() > serverState->idleBufferSize) {
+      buffer.shrink_to_fit();
+    }
 
+    // Read the header first, proxy routes stream the body
+    ServerProxy::requestParserType headerParser;
+    headerParser.header_limit(serverState->headerLimit);
+    headerParser.body_limit(std::numeric_limits<std::uint64_t>::max());
+    http::async_read_header(sslStream, buffer, headerParser, yieldContext[ec]);
     if (ec == http::error::end_of_stream) {
       logStatus("::Connection::run", "http::error::end_of_stream");
       break;
     }
+    if (ec == http::error::header_limit || ec == http::error::buffer_overflow) {
+      logStatus("::Connection::run", "http::async_read_header", ec);
+      rejectRequest(http::status::request_header_fields_too_large, 11,
+                    yieldContext);
+      break;
+    }
+    if (ec) {
+      logStatus("::Connection::run", "http::async_read_header", ec);
+      return -1;
+    }
+    const auto &fields = headerParser.get().base();
+    if (static_cast<std::size_t>(std::distance(fields.begin(), fields.end())) >
+        serverState->headerCountLimit) {
+      logStatus("::Connection::run", "ERROR: header count limit exceeded");
+      rejectRequest(http::status::request_header_fields_too_large,
+                    headerParser.get().version(), yieldContext);
+      break;
+    }
+    beast::string_view target = headerParser.get().target();
+    beast::string_view path = target.substr(0, target.find('?'));
+    // an unread body can not be skipped, throttling it closes the connection
+    bool throttleCloseFlag = !headerParser.get().keep_alive() ||
+                             headerParser.chunked() ||
+                             headerParser.content_length().value_or(0) > 0;
+    const std::string *throttleResponsePtr = serverState->rateLimitPtr->check(
+        clientAddress, headerParser.get().method_string(), path,
+        throttleCloseFlag);
+    if (throttleResponsePtr) {
+      logStatus("::Connection::run", "rate limit exceeded");
+      net::async_write(sslStream, net::buffer(*throttleResponsePtr),
+                       yieldContext[ec]);
+      if (ec) {
+        logStatus("::Connection::run", "net::async_write", ec);
+        return -1;
+      }
+      if (throttleCloseFlag) {
+        break;
+      }
+      continue;
+    }
+    auto upstreamNameOpt =
+        routePtr->findProxy(headerParser.get().method_string(), path);
+    if (upstreamNameOpt) {
+      bool keepAlive = headerParser.get().keep_alive();
+      rc = serverState->proxyPtr->forward(sslStream, buffer, headerParser,
+                                          *upstreamNameOpt, clientAddress,
+                                          yieldContext);
+      if (rc < 0) {
+        // the request may be half read, the connection can not be reused
+        beast::get_lowest_layer(sslStream).close();
+        return -1;
+      }
+      if (!keepAlive || rc > 0) {
+        break;
+      }
+      continue;
+    }
+
+    // Read the rest of the request, only proxy routes stream larger bodies
+    http::request_parser<http::string_body> parser{std::move(headerParser)};
+    parser.body_limit(serverState->bodyLimit);
+    if (parser.content_length().value_or(0) > serverState->bodyLimit) {
+      logStatus("::Connection::run", "ERROR: body limit exceeded");
+      rejectRequest(http::status::payload_too_large, parser.get().version(),
+                    yieldContext);
+      break;
+    }
+    http::async_read(sslStream, buffer, parser, yieldContext[ec]);
+    if (ec == http::error::body_limit) {
+      logStatus("::Connection::run", "http::async_read", ec);
+      rejectRequest(http::status::payload_too_large, parser.get().version(),
+                    yieldContext);
+      break;
+    }
     if (ec) {
       logStatus("::Connection::run", "http::async_read", ec);
       return -1;
     }
+    requestBeastInternal reqBeast =
+        std::make_shared<http::request<http::string_body>>(parser.release());
+    std::stringstream ss;
+    ss << "http::async_read request\n" << *reqBeast << "\n";
+    logStatus("::ServerImpl::do_session", ss.str());
 
     // Send the response
     responseBeastInternal resBeast =
@@ -83,11 +169,111 @@ int Connection::run(net::yield_context yieldContext) {
     reqImpl->parseRequest();
     std::shared_ptr<ResponseImpl> resImpl = std::make_shared<ResponseImpl>();
     resImpl->setResponse(resBeast);
-    rc = routePtr->doGetSignal(reqImpl->path(), reqImpl, resImpl);
+    const RouteCache *routeCachePtr = routePtr->findCache(reqImpl->path());
+    ServerCacheResponse cacheResponse;
+    if (routeCachePtr) {
+      // the query and the vary headers select the body
+      std::string cacheKey = std::string(reqBeast->target());
+      for (auto &name : routeCachePtr->varyList) {
+        cacheKey += "\n" + name + ": ";
+        auto it = reqBeast->find(name);
+        if (it != reqBeast->end()) {
+          cacheKey += std::string(it->value());
+        }
+      }
+      serverCacheResultType result = serverState->cachePtr->fetch(
+          cacheKey, routeCachePtr->ttl,
+          [&]() -> serverCacheResultType {
+            int rc_ = routePtr->doGetSignal(reqImpl->path(), reqImpl, resImpl);
+            if (rc_ < 0) {
+              return {rc_, {}};
+            }
+            resImpl->parseResponse();
+            // the length is set again for the body each response writes
+            auto headerPtr =
+                std::make_shared<http::response_header<>>(resBeast->base());
+            headerPtr->erase(http::field::content_length);
+            ServerCacheResponse response{
+                headerPtr,
+                std::make_shared<const std::string>(
+                    std::move(resBeast->body())),
+                {}};
+            // hashed once here instead of on every hit
+            if (headerPtr->result_int() / 100 == 2 &&
+                routePtr->findEtag(reqImpl->path())) {
+              response.etag = bodyEtag(*response.bodyPtr);
+            }
+            // waiting requests share any answer, per client ones are not
+            // stored
+            auto directiveMap = ClientCache::parseCacheControl(
+                std::string((*headerPtr)[http::field::cache_control]));
+            if (headerPtr->find(http::field::set_cookie) != headerPtr->end() ||
+                directiveMap.count("private") ||
+                directiveMap.count("no-store")) {
+              return {2, response};
+            }
+            switch (headerPtr->result_int()) {
+            case 200:
+            case 203:
+            case 204:
+            case 300:
+            case 301:
+            case 308:
+            case 404:
+            case 405:
+            case 410:
+            case 414:
+            case 501:
+              return {0, response};
+            default:
+              return {2, response};
+            }
+          },
+          yieldContext);
+      rc = result.first;
+      cacheResponse = result.second;
+    } else {
+      rc = routePtr->doGetSignal(reqImpl->path(), reqImpl, resImpl);
+    }
+    std::shared_ptr<const std::string> cacheBodyPtr = cacheResponse.bodyPtr;
     if (rc < 0) {
       notFound(reqBeast, resBeast, reqImpl->path());
     }
-    resImpl->parseResponse();
+    if (!cacheBodyPtr) {
+      resImpl->parseResponse();
+    }
+    // validators are only added to 2xx answers of the route function,
+    // conditionals are ignored otherwise, RFC 7232 5
+    const unsigned status = cacheBodyPtr
+                                ? cacheResponse.headerPtr->result_int()
+                                : resBeast->result_int();
+    std::string etag;
+    bool notModifiedFlag = false;
+    if (rc == 0 && status / 100 == 2 && routePtr->findEtag(reqImpl->path())) {
+      etag = cacheBodyPtr ? cacheResponse.etag : bodyEtag(resBeast->body());
+      auto it = reqBeast->find(http::field::if_none_match);
+      notModifiedFlag = it != reqBeast->end() && etagMatch(it->value(), etag);
+    }
+    if (notModifiedFlag) {
+      rc = notModified(reqBeast,
+                       cacheBodyPtr ? *cacheResponse.headerPtr
+                                    : resBeast->base(),
+                       etag, yieldContext);
+      if (rc < 0) {
+        return -1;
+      }
+      continue;
+    }
+    if (!etag.empty() && !cacheBodyPtr) {
+      resBeast->set(http::field::etag, etag);
+    }
+    if (cacheBodyPtr) {
+      rc = writeCached(reqBeast, cacheResponse, etag, yieldContext);
+      if (rc < 0) {
+        return -1;
+      }
+      continue;
+    }
     // Write Response
     std::stringstream ss2;
     ss2 << "http::async_write response\n" << *resBeast << "\n";
@@ -116,6 +302,77 @@ int Connection::run(net::yield_context yieldContext) {
   return 0;
 }
 
+int Connection::rejectRequest(http::status status, unsigned int version,
+                              net::yield_context yieldContext) {
+  beast::error_code ec;
+  http::response<http::string_body> res{status, version};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type, "text/html");
+  // the rest of the request is not read
+  res.keep_alive(false);
+  res.body() = std::string(http::obsolete_reason(status));
+  res.prepare_payload();
+  beast::get_lowest_layer(sslStream).expires_after(std::chrono::seconds(30));
+  http::async_write(sslStream, res, yieldContext[ec]);
+  if (ec) {
+    logStatus("::Connection::rejectRequest", "http::async_write", ec);
+    return -1;
+  }
+  return 0;
+}
+
+int Connection::writeCached(requestBeastInternal req,
+                            const ServerCacheResponse &response,
+                            const std::string &etag,
+                            net::yield_context yieldContext) {
+  beast::error_code ec;
+  // the route's status and fields, written straight from the cached body
+  // without a copy
+  http::response<http::span_body<const char>> res{*response.headerPtr};
+  res.version(req->version());
+  res.keep_alive(req->keep_alive());
+  if (!etag.empty()) {
+    res.set(http::field::etag, etag);
+  }
+  res.body() = http::span_body<const char>::value_type(
+      response.bodyPtr->data(), response.bodyPtr->size());
+  res.prepare_payload();
+  http::async_write(sslStream, res, yieldContext[ec]);
+  if (ec) {
+    logStatus("::Connection::writeCached", "http::async_write", ec);
+    return -1;
+  }
+  return 0;
+}
+
+int Connection::notModified(requestBeastInternal req,
+                            const http::response_header<> &header,
+                            const std::string &etag,
+                            net::yield_context yieldContext) {
+  beast::error_code ec;
+  // a 304 has neither a body nor a Content-Length
+  http::response<http::empty_body> res{http::status::not_modified,
+                                       req->version()};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::etag, etag);
+  // RFC 7232 4.1, the fields a 200 would have sent
+  for (auto field : {http::field::cache_control, http::field::content_location,
+                     http::field::date, http::field::expires,
+                     http::field::vary}) {
+    auto range = header.equal_range(field);
+    for (auto it = range.first; it != range.second; ++it) {
+      res.insert(field, it->value());
+    }
+  }
+  res.keep_alive(req->keep_alive());
+  http::async_write(sslStream, res, yieldContext[ec]);
+  if (ec) {
+    logStatus("::Connection::notModified", "http::async_write", ec);
+    return -1;
+  }
+  return 0;
+}
+
 int Connection::badRequest(requestBeastInternal req, responseBeastInternal res,
                            beast::string_view what) {
   res->result(http::status::bad_request);
@@ -19,6 +19,7 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <thread>
@@ -43,6 +44,7 @@
 #include <boost/config.hpp>
 
 // Local Project
+#include "ServerCache.hpp"
 #include "ServerRoute.hpp"
 #include "ServerSession.hpp"
 #include "ServerState.hpp"
@@ -78,6 +80,17 @@ public:
   // Start the asynchronous operation
   int run(net::yield_context yieldContext);
 
+  /* Answers a request that exceeds a limit and asks the client to close */
+  int rejectRequest(http::status, unsigned int version,
+                    net::yield_context yieldContext);
+  /* Writes a response of the server cache, whose body stays shared */
+  int writeCached(requestBeastInternal req,
+                  const ServerCacheResponse &response,
+                  const std::string &etag, net::yield_context yieldContext);
+  /* Answers a request whose If-None-Match matched the entity tag */
+  int notModified(requestBeastInternal req,
+                  const http::response_header<> &header,
+                  const std::string &etag, net::yield_context yieldContext);
   int badRequest(requestBeastInternal req, responseBeastInternal res,
              beast::string_view what);
   int notFound(requestBeastInternal req, responseBeastInternal res,
@@ -48,8 +48,11 @@ int Listener::run(net::yield_context yieldContext) {
     return -1;
   }
 
+  // failed options are logged, the listener runs without them
+  serverState->socketOptionsPtr->applyListen(acceptor);
+
   // Start listening for connections
-  acceptor.listen(net::socket_base::max_listen_connections, ec);
+  acceptor.listen(serverState->socketOptionsPtr->backlog, ec);
   if (ec) {
     logStatus("::Listener::run", "acceptor.listen", ec);
     return -1;
@@ -63,6 +66,7 @@ int Listener::run(net::yield_context yieldContext) {
       logStatus("::Listener::run", "acceptor.async_accept", ec);
       continue;
     }
+    serverState->socketOptionsPtr->applyAccepted(socket);
 
     std::shared_ptr<Connection> conn;
     {
@@ -0,0 +1,585 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// Local Project
+#include "ServerProxy.hpp"
+
+namespace beast = boost::beast;   // from <boost/beast.hpp>
+namespace http = beast::http;     // from <boost/beast/http.hpp>
+namespace net = boost::asio;      // from <boost/asio.hpp>
+namespace ssl = boost::asio::ssl; // from <boost/asio/ssl.hpp>
+using tcp = boost::asio::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ServerProxy::ServerProxy() {
+  timeout = std::chrono::seconds(60);
+  bufferSize = 64 * 1024;
+}
+ServerProxy::~ServerProxy() {}
+
+int ServerProxy::setClientState(std::shared_ptr<ClientState> clientState_) {
+  clientState = clientState_;
+  return 0;
+}
+
+int ServerProxy::extractSettings(const rapidjson::Value &serverJson) {
+  JsonImpl json;
+  auto timeoutOpt = json.getMemberInt(serverJson, "proxyTimeout");
+  if (timeoutOpt) {
+    timeout = std::chrono::seconds(std::max<int>(1, *timeoutOpt));
+  }
+  auto bufferSizeOpt = json.getMemberInt(serverJson, "proxyBufferSize");
+  if (bufferSizeOpt) {
+    bufferSize = static_cast<std::size_t>(std::max<int>(1024, *bufferSizeOpt));
+  }
+  if (!serverJson.HasMember("upstreams")) {
+    return 0;
+  }
+  const rapidjson::Value &upstreamsJson = serverJson["upstreams"];
+  if (!upstreamsJson.IsObject()) {
+    logStatus("::ServerProxy::extractSettings",
+              "ERROR: upstreams is not an object.");
+    return -1;
+  }
+  for (auto &member : upstreamsJson.GetObject()) {
+    if (!member.value.IsString()) {
+      logStatus("::ServerProxy::extractSettings",
+                std::string("ERROR: upstream ") + member.name.GetString() +
+                    " is not a URL.");
+      continue;
+    }
+    addUpstream(member.name.GetString(), member.value.GetString());
+  }
+  return 0;
+}
+
+int ServerProxy::addUpstream(const std::string &name, const std::string &url) {
+  auto upstreamPtr = std::make_shared<ClientUpstream>();
+  upstreamPtr->name = name;
+  if (upstreamPtr->parse(url) < 0) {
+    logStatus("::ServerProxy::addUpstream",
+              "ERROR: invalid upstream URL " + url);
+    return -1;
+  }
+  upstreamMap[name] = upstreamPtr;
+  return 0;
+}
+
+std::shared_ptr<ClientUpstream>
+ServerProxy::getUpstream(const std::string &name) {
+  auto it = upstreamMap.find(name);
+  if (it == upstreamMap.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void ServerProxy::removeHopByHop(http::fields &fields) {
+  // the headers named by Connection only apply to this hop
+  std::vector<std::string> connectionList;
+  auto connectionRange = fields.equal_range(http::field::connection);
+  for (auto it = connectionRange.first; it != connectionRange.second; ++it) {
+    for (auto &token : http::token_list(it->value())) {
+      connectionList.emplace_back(token);
+    }
+  }
+  for (auto &name : connectionList) {
+    fields.erase(name);
+  }
+  fields.erase(http::field::connection);
+  fields.erase(http::field::keep_alive);
+  fields.erase(http::field::proxy_connection);
+  fields.erase(http::field::proxy_authenticate);
+  fields.erase(http::field::proxy_authorization);
+  fields.erase(http::field::te);
+  fields.erase(http::field::trailer);
+  fields.erase(http::field::upgrade);
+}
+
+int ServerProxy::acquire(ClientUpstream &upstream,
+                         std::shared_ptr<ClientConnection> &connectionPtr,
+                         net::yield_context yieldContext) {
+  beast::error_code ec;
+  // async_initiate moves from the token
+  auto acquireYield = yieldContext[ec];
+  connectionPtr = net::async_initiate<
+      net::yield_context,
+      void(beast::error_code, std::shared_ptr<ClientConnection>)>(
+      [this, &upstream](auto handler) {
+        // the pool may call back inline or from another thread
+        auto executor = net::get_associated_executor(handler);
+        clientState->poolPtr->asyncAcquire(
+            upstream.poolKey,
+            [handler, executor](int rc,
+                                std::shared_ptr<ClientConnection> acquired) {
+              net::post(executor, [handler, rc, acquired]() mutable {
+                handler(rc < 0 ? beast::error_code(net::error::timed_out)
+                               : beast::error_code(),
+                        acquired);
+              });
+            });
+      },
+      acquireYield);
+  if (ec) {
+    logStatus("::ServerProxy::acquire", "pool " + upstream.poolKey, ec);
+    return -1;
+  }
+  return 0;
+}
+
+int ServerProxy::connect(ClientUpstream &upstream,
+                         std::shared_ptr<ClientConnection> connectionPtr,
+                         net::yield_context yieldContext) {
+  beast::error_code ec;
+  if (upstream.transport == clientTransport::tls) {
+    connectionPtr->sslContextPtr = clientState->getSslContext();
+  }
+  connectionPtr->streamPtr = std::make_unique<ClientStream>(
+      upstream.transport, clientState->ioContext,
+      connectionPtr->sslContextPtr.get());
+  ClientStream &stream = *connectionPtr->streamPtr;
+  /* Every step is bounded by timeout. The handler runs on the strand of
+   * this coroutine and does nothing once its step finished.
+   */
+  net::steady_timer timer(clientState->ioContext);
+  auto strand = yieldContext.handler_.get_executor();
+  std::shared_ptr<bool> stepDonePtr;
+  auto armTimer = [&](std::function<void()> onTimeout) {
+    stepDonePtr = std::make_shared<bool>(false);
+    timer.expires_after(timeout);
+    timer.async_wait(net::bind_executor(
+        strand, [onTimeout, donePtr = stepDonePtr](beast::error_code timerEc) {
+          if (!timerEc && !*donePtr) {
+            onTimeout();
+          }
+        }));
+  };
+  auto disarmTimer = [&]() {
+    *stepDonePtr = true;
+    timer.cancel();
+  };
+
+  if (upstream.transport == clientTransport::local) {
+    armTimer([connectionPtr]() { connectionPtr->close(); });
+    stream.unixSocket()->async_connect(
+        net::local::stream_protocol::endpoint(upstream.unixSocketPath),
+        yieldContext[ec]);
+    disarmTimer();
+    if (ec) {
+      logStatus("::ServerProxy::connect", "connect " + upstream.unixSocketPath,
+                ec);
+      return -1;
+    }
+    return 0;
+  }
+
+  auto resolveYield = yieldContext[ec];
+  auto resolved = net::async_initiate<
+      net::yield_context,
+      void(beast::error_code, tcp::resolver::results_type)>(
+      [this, &upstream](auto handler) {
+        auto executor = net::get_associated_executor(handler);
+        clientState->resolverPtr->asyncResolve(
+            upstream.host, upstream.port,
+            [handler, executor](beast::error_code resolveEc,
+                                tcp::resolver::results_type results) {
+              net::post(executor, [handler, resolveEc, results]() mutable {
+                handler(resolveEc, results);
+              });
+            });
+      },
+      resolveYield);
+  if (ec) {
+    logStatus("::ServerProxy::connect", "resolve " + upstream.host, ec);
+    return -1;
+  }
+
+  auto connectorPtr = std::make_shared<ClientConnector>(
+      clientState->ioContext, clientState->getSettings()->connectStagger);
+  armTimer([connectorPtr]() { connectorPtr->cancel(); });
+  auto connectYield = yieldContext[ec];
+  auto socketPtr = net::async_initiate<
+      net::yield_context,
+      void(beast::error_code, std::shared_ptr<tcp::socket>)>(
+      [resolved, connectorPtr](auto handler) {
+        auto executor = net::get_associated_executor(handler);
+        connectorPtr->start(
+            resolved, [handler, executor](beast::error_code connectEc,
+                                          tcp::socket socket) {
+              auto connected = std::make_shared<tcp::socket>(std::move(socket));
+              net::post(executor, [handler, connectEc, connected]() mutable {
+                handler(connectEc, connected);
+              });
+            });
+      },
+      connectYield);
+  disarmTimer();
+  if (ec) {
+    logStatus("::ServerProxy::connect", "connect " + upstream.host, ec);
+    return -1;
+  }
+  clientState->connectNum++;
+  clientState->connectAttemptNum += connectorPtr->getAttemptNum();
+  if (connectorPtr->winnerIndex > 0) {
+    clientState->connectFallbackNum++;
+  }
+  *stream.tcpSocket() = std::move(*socketPtr);
+  if (upstream.transport == clientTransport::tcp) {
+    return 0;
+  }
+
+  // HTTP/1.1 only, h2 is not offered through ALPN
+  ClientStream::tlsStreamType &tlsStream = *stream.tls();
+  if (!clientState->getSettings()->skipHostnameVerification) {
+    boost::certify::set_server_hostname(tlsStream, upstream.host);
+  }
+  boost::certify::sni_hostname(tlsStream, upstream.host);
+  connectionPtr->sessionKey = upstream.poolKey;
+  clientState->sessionCachePtr->setSession(tlsStream.native_handle(),
+                                           &connectionPtr->sessionKey);
+  armTimer([connectionPtr]() { connectionPtr->close(); });
+  tlsStream.async_handshake(ssl::stream_base::handshake_type::client,
+                            yieldContext[ec]);
+  disarmTimer();
+  if (ec) {
+    logStatus("::ServerProxy::connect", "handshake " + upstream.host, ec);
+    return -1;
+  }
+  clientState->sessionCachePtr->addHandshake(tlsStream.native_handle());
+  return 0;
+}
+
+template <bool isRequest, class InputStream, class OutputStream>
+int ServerProxy::relay(InputStream &input, beast::flat_buffer &buffer,
+                       http::parser<isRequest, http::buffer_body> &parser,
+                       OutputStream &output,
+                       const std::function<void()> &touch,
+                       net::yield_context yieldContext) {
+  beast::error_code ec;
+  std::vector<char> chunk(bufferSize);
+  http::serializer<isRequest, http::buffer_body> serializer{parser.get()};
+  do {
+    if (!parser.is_done()) {
+      parser.get().body().data = chunk.data();
+      parser.get().body().size = chunk.size();
+      touch();
+      http::async_read(input, buffer, parser, yieldContext[ec]);
+      if (ec == http::error::need_buffer) {
+        ec = {};
+      }
+      if (ec) {
+        logStatus("::ServerProxy::relay", "http::async_read", ec);
+        return -1;
+      }
+      parser.get().body().size = chunk.size() - parser.get().body().size;
+      parser.get().body().data = chunk.data();
+      parser.get().body().more = !parser.is_done();
+    } else {
+      parser.get().body().data = nullptr;
+      parser.get().body().size = 0;
+      parser.get().body().more = false;
+    }
+    touch();
+    http::async_write(output, serializer, yieldContext[ec]);
+    if (ec == http::error::need_buffer) {
+      ec = {};
+    }
+    if (ec) {
+      logStatus("::ServerProxy::relay", "http::async_write", ec);
+      return -2;
+    }
+  } while (!parser.is_done() && !serializer.is_done());
+  return 0;
+}
+
+int ServerProxy::gatewayError(downstreamType &downstream, http::status status,
+                              unsigned int version, bool keepAlive,
+                              net::yield_context yieldContext) {
+  beast::error_code ec;
+  http::response<http::string_body> res{status, version};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type, "text/html");
+  res.keep_alive(keepAlive);
+  res.body() = std::string(http::obsolete_reason(status));
+  res.prepare_payload();
+  beast::get_lowest_layer(downstream).expires_after(timeout);
+  http::async_write(downstream, res, yieldContext[ec]);
+  if (ec) {
+    logStatus("::ServerProxy::gatewayError", "http::async_write", ec);
+    return -1;
+  }
+  return keepAlive ? 0 : -1;
+}
+
+int ServerProxy::forward(downstreamType &downstream, beast::flat_buffer &buffer,
+                         requestParserType &headerParser,
+                         const std::string &upstreamName,
+                         const std::string &clientAddress,
+                         net::yield_context yieldContext) {
+  beast::error_code ec;
+  // the body is read in chunks as it is relayed
+  http::request_parser<http::buffer_body> requestParser{
+      std::move(headerParser)};
+  requestParser.body_limit(std::numeric_limits<std::uint64_t>::max());
+  auto &req = requestParser.get();
+  const unsigned int version = req.version();
+  const bool keepAlive = req.keep_alive();
+  const bool headFlag = req.method() == http::verb::head;
+
+  auto upstreamPtr = getUpstream(upstreamName);
+  // a group counts the request as outstanding on its endpoint until return
+  std::shared_ptr<ClientUpstreamLease> leasePtr;
+  if (!upstreamPtr && clientState) {
+    auto groupPtr = clientState->getUpstreamGroup(upstreamName);
+    if (groupPtr) {
+      leasePtr = groupPtr->pick();
+    }
+    if (leasePtr) {
+      upstreamPtr = leasePtr->upstreamPtr;
+    }
+  }
+  if (!upstreamPtr || !clientState) {
+    logStatus("::ServerProxy::forward",
+              "ERROR: no upstream named " + upstreamName);
+    return gatewayError(downstream, http::status::bad_gateway, version,
+                        keepAlive && requestParser.is_done(), yieldContext);
+  }
+  ClientUpstream &upstream = *upstreamPtr;
+
+  // the client waits for 100 Continue before sending the body
+  const bool continueFlag =
+      beast::iequals(req[http::field::expect], "100-continue");
+  req.erase(http::field::expect);
+  removeHopByHop(req);
+  std::string forwardedFor(req["X-Forwarded-For"]);
+  req.set("X-Forwarded-For",
+          forwardedFor.empty() ? clientAddress
+                               : forwardedFor + ", " + clientAddress);
+  req.set("X-Forwarded-Proto", "https");
+  if (req.find(http::field::host) != req.end()) {
+    req.set("X-Forwarded-Host", req[http::field::host]);
+  }
+  req.set(http::field::host, upstream.hostHeader);
+  // "*" of OPTIONS has no path to prefix
+  if (!upstream.pathPrefix.empty() && req.target().starts_with('/')) {
+    req.target(upstream.pathPrefix + std::string(req.target()));
+  }
+  req.version(11);
+  if (continueFlag && !requestParser.is_done()) {
+    http::response<http::empty_body> continueRes{http::status::continue_,
+                                                 version};
+    beast::get_lowest_layer(downstream).expires_after(timeout);
+    http::async_write(downstream, continueRes, yieldContext[ec]);
+    if (ec) {
+      logStatus("::ServerProxy::forward", "100 Continue", ec);
+      return -1;
+    }
+  }
+
+  /* Closes the upstream socket when either side stalls for timeout. The
+   * handler runs on the strand of this coroutine and a new state is made
+   * for every attempt, so a handler that was already queued when the timer
+   * was cancelled can not close a connection handed back to the pool.
+   */
+  std::shared_ptr<ClientConnection> connectionPtr;
+  auto strand = yieldContext.handler_.get_executor();
+  enum class idleState { running, timedOut, stopped };
+  std::shared_ptr<idleState> idleStatePtr;
+  net::steady_timer idleTimer(clientState->ioContext);
+  auto touch = [&]() {
+    beast::get_lowest_layer(downstream).expires_after(timeout);
+    idleTimer.expires_after(timeout);
+    idleTimer.async_wait(net::bind_executor(
+        strand, [idleConnectionPtr = connectionPtr,
+                 statePtr = idleStatePtr](beast::error_code timerEc) {
+          if (!timerEc && idleConnectionPtr &&
+              *statePtr == idleState::running) {
+            *statePtr = idleState::timedOut;
+            idleConnectionPtr->close();
+          }
+        }));
+  };
+  auto stopIdle = [&]() {
+    idleTimer.cancel();
+    if (*idleStatePtr == idleState::running) {
+      *idleStatePtr = idleState::stopped;
+    }
+  };
+
+  /* A request body is uploaded by a second coroutine on the same strand
+   * while this one reads the response. Upstreams may answer before the
+   * whole body arrived or stream the response while they read the body.
+   */
+  bool uploadDoneFlag = true;
+  int uploadRc = 0;
+  net::steady_timer uploadTimer(clientState->ioContext);
+  auto waitUpload = [&]() {
+    while (!uploadDoneFlag) {
+      beast::error_code waitEc;
+      uploadTimer.expires_at(net::steady_timer::time_point::max());
+      uploadTimer.async_wait(yieldContext[waitEc]);
+    }
+  };
+  // aborts an upload still running, the downstream request is then unusable
+  auto stopUpload = [&]() {
+    if (uploadDoneFlag) {
+      return;
+    }
+    connectionPtr->close();
+    beast::get_lowest_layer(downstream).cancel();
+    waitUpload();
+  };
+
+  beast::flat_buffer upstreamBuffer;
+  std::optional<http::response_parser<http::buffer_body>> responseParser;
+  // outcome of an attempt for the outlier ejection of the group
+  std::chrono::steady_clock::time_point attemptTime;
+  auto addSample = [&](bool failFlag) {
+    if (leasePtr) {
+      leasePtr->addSample(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - attemptTime),
+          failFlag);
+    }
+  };
+  for (int attemptNum = 0;; attemptNum++) {
+    idleStatePtr = std::make_shared<idleState>(idleState::running);
+    if (acquire(upstream, connectionPtr, yieldContext) < 0) {
+      return gatewayError(downstream, http::status::gateway_timeout, version,
+                          keepAlive && requestParser.is_done(),
+                          yieldContext);
+    }
+    attemptTime = std::chrono::steady_clock::now();
+    const bool reusedFlag = connectionPtr != nullptr;
+    if (!reusedFlag) {
+      connectionPtr = std::make_shared<ClientConnection>();
+      if (connect(upstream, connectionPtr, yieldContext) < 0) {
+        addSample(true);
+        clientState->poolPtr->release(upstream.poolKey, nullptr, false);
+        return gatewayError(downstream, http::status::bad_gateway, version,
+                            keepAlive && requestParser.is_done(),
+                            yieldContext);
+      }
+    }
+    ClientStream &upstreamStream = *connectionPtr->streamPtr;
+
+    // a request without a body can be sent again on a new connection
+    const bool retryableFlag =
+        reusedFlag && attemptNum == 0 && requestParser.is_done();
+    int rc = 0;
+    if (requestParser.is_done()) {
+      rc = relay(downstream, buffer, requestParser, upstreamStream, touch,
+                 yieldContext);
+    } else {
+      uploadDoneFlag = false;
+      net::spawn(yieldContext, [&](net::yield_context uploadYield) {
+        uploadRc = relay(downstream, buffer, requestParser, upstreamStream,
+                         touch, uploadYield);
+        if (uploadRc == -1) {
+          // the client went away, stop waiting for the response
+          connectionPtr->close();
+        }
+        uploadDoneFlag = true;
+        uploadTimer.cancel();
+      });
+    }
+    if (rc == 0) {
+      upstreamBuffer.clear();
+      // interim responses are not forwarded
+      do {
+        responseParser.emplace();
+        responseParser->body_limit(std::numeric_limits<std::uint64_t>::max());
+        responseParser->skip(headFlag);
+        touch();
+        http::async_read_header(upstreamStream, upstreamBuffer,
+                                *responseParser, yieldContext[ec]);
+      } while (!ec && responseParser->get().result_int() / 100 == 1 &&
+               responseParser->get().result() !=
+                   http::status::switching_protocols);
+      if (ec) {
+        logStatus("::ServerProxy::forward", "http::async_read_header", ec);
+        rc = -2;
+        stopUpload();
+        if (uploadRc == -1) {
+          rc = -1;
+        }
+      }
+    }
+    if (rc == 0) {
+      addSample(responseParser->get().result_int() >= 500);
+      break;
+    }
+    if (rc == -2 && !retryableFlag) {
+      addSample(true);
+    }
+    stopIdle();
+    clientState->poolPtr->release(upstream.poolKey, connectionPtr, false);
+    connectionPtr.reset();
+    if (rc == -1) {
+      // the downstream client went away
+      return -1;
+    }
+    if (*idleStatePtr == idleState::timedOut) {
+      return gatewayError(downstream, http::status::gateway_timeout, version,
+                          keepAlive && requestParser.is_done(),
+                          yieldContext);
+    }
+    if (!retryableFlag) {
+      return gatewayError(downstream, http::status::bad_gateway, version,
+                          keepAlive && requestParser.is_done(),
+                          yieldContext);
+    }
+    logStatus("::ServerProxy::forward", "retry on a new connection");
+  }
+
+  auto &res = responseParser->get();
+  const bool upstreamKeepAlive = res.keep_alive();
+  removeHopByHop(res);
+  res.version(version);
+  // neither a length nor the end of the body is known before it is read
+  bool closeFlag = false;
+  if (!responseParser->is_done() && !responseParser->content_length()) {
+    if (version < 11) {
+      // HTTP/1.0 has no chunked coding, closing the connection ends the body
+      res.chunked(false);
+      closeFlag = true;
+    } else if (!res.chunked()) {
+      res.chunked(true);
+    }
+  }
+  res.keep_alive(keepAlive && !closeFlag);
+  int rc = relay(*connectionPtr->streamPtr, upstreamBuffer, *responseParser,
+                 downstream, touch, yieldContext);
+  /* The upstream answered before it read the whole body. An upload that
+   * only has its last write pending is let finish.
+   */
+  const bool earlyFlag = !requestParser.is_done();
+  if (earlyFlag) {
+    stopUpload();
+  } else {
+    waitUpload();
+  }
+  stopIdle();
+  const bool reusable = rc == 0 && !earlyFlag && uploadRc == 0 &&
+                        upstreamKeepAlive && requestParser.is_done() &&
+                        responseParser->is_done() &&
+                        upstreamBuffer.size() == 0;
+  clientState->poolPtr->release(upstream.poolKey, connectionPtr, reusable);
+  if (rc != 0 || earlyFlag || !requestParser.is_done()) {
+    return -1;
+  }
+  return closeFlag ? 1 : 0;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,131 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_SERVER_PROXY_H
+#define BOOKFILER_MODULE_HTTP_HTTP_SERVER_PROXY_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/certify/extensions.hpp>
+#include <boost/certify/https_verification.hpp>
+
+// Local Project
+#include "ClientState.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Forwards requests of proxy routes to their upstream over keep-alive
+ * connections from the client pool. Bodies are streamed in both directions
+ * through a fixed buffer and never held whole in memory.
+ */
+class ServerProxy {
+public:
+  using downstreamType =
+      boost::beast::ssl_stream<boost::beast::tcp_stream>;
+  using requestParserType =
+      boost::beast::http::request_parser<boost::beast::http::empty_body>;
+
+private:
+  std::shared_ptr<ClientState> clientState;
+  std::unordered_map<std::string, std::shared_ptr<ClientUpstream>>
+      upstreamMap;
+  /* Waits for a slot in the client pool. A null connection with rc = 0 means
+   * a new connection must be opened in the slot.
+   */
+  int acquire(ClientUpstream &, std::shared_ptr<ClientConnection> &,
+              boost::asio::yield_context);
+  /* Opens the connection with the same transports and happy eyeballs as
+   * ClientImpl
+   */
+  int connect(ClientUpstream &, std::shared_ptr<ClientConnection>,
+              boost::asio::yield_context);
+  /* Writes the header of the message being read by parser to output, then
+   * copies its body. Returns -1 if reading input failed and -2 if writing
+   * output failed. touch is called before every read and write to restart
+   * the idle timeout.
+   */
+  template <bool isRequest, class InputStream, class OutputStream>
+  int relay(InputStream &, boost::beast::flat_buffer &,
+            boost::beast::http::parser<isRequest,
+                                       boost::beast::http::buffer_body> &,
+            OutputStream &, const std::function<void()> &touch,
+            boost::asio::yield_context);
+  /* Answers a request the upstream could not serve */
+  int gatewayError(downstreamType &, boost::beast::http::status,
+                   unsigned int version, bool keepAlive,
+                   boost::asio::yield_context);
+
+public:
+  ServerProxy();
+  ~ServerProxy();
+  // per read or write on either side
+  std::chrono::seconds timeout;
+  std::size_t bufferSize;
+  int setClientState(std::shared_ptr<ClientState>);
+  /* Reads the "upstreams" object of the server settings. Each member maps a
+   * name to a URL.
+   */
+  int extractSettings(const rapidjson::Value &);
+  int addUpstream(const std::string &name, const std::string &url);
+  /* Returns the upstream registered under name or nullptr. Must not be
+   * called concurrently with addUpstream.
+   */
+  std::shared_ptr<ClientUpstream> getUpstream(const std::string &name);
+  /* Removes the hop-by-hop headers of RFC 7230 section 6.1 and the headers
+   * listed by Connection. The framing headers stay, the serializer writes
+   * the body the way they describe.
+   */
+  static void removeHopByHop(boost::beast::http::fields &);
+  /* Forwards the request whose header was read by parser to the upstream
+   * or upstream group named upstreamName and writes the upstream response
+   * to the downstream stream. Answers 502 or 504 if the
+   * upstream fails before the response started. Returns 0 once the
+   * response was written, 1 if the downstream connection must then be closed
+   * to end the body, -1 if the downstream connection is unusable.
+   */
+  int forward(downstreamType &, boost::beast::flat_buffer &,
+              requestParserType &, const std::string &upstreamName,
+              const std::string &clientAddress, boost::asio::yield_context);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_SERVER_PROXY_H
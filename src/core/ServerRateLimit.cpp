@@ -0,0 +1,187 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <sstream>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+
+// Local Project
+#include "ServerRateLimit.hpp"
+#include "ServerUtil.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ServerRateLimit::ServerRateLimit() {}
+ServerRateLimit::~ServerRateLimit() {}
+
+std::unique_ptr<ServerRateLimit::limit>
+ServerRateLimit::newLimit(double perSecond, double burst) {
+  namespace http = boost::beast::http;
+  auto limitPtr = std::make_unique<limit>();
+  limitPtr->method = "*";
+  limitPtr->prefixFlag = true;
+  limitPtr->perSecond = perSecond;
+  // a bucket has to hold the token of at least one request
+  limitPtr->burst = std::max(1.0, burst);
+  limitPtr->fillTime =
+      std::chrono::duration<double>(limitPtr->burst / perSecond);
+  auto now = std::chrono::steady_clock::now();
+  for (auto &shard_ : limitPtr->shardList) {
+    shard_.sweepTime = now;
+  }
+
+  // an empty bucket has the next token after 1 / perSecond seconds
+  long long retryAfter =
+      std::max(1LL, static_cast<long long>(std::ceil(1 / perSecond)));
+  http::response<http::string_body> res{http::status::too_many_requests, 11};
+  res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  res.set(http::field::content_type, "text/plain");
+  res.set(http::field::retry_after, std::to_string(retryAfter));
+  res.body() = "Too Many Requests";
+  res.prepare_payload();
+  std::stringstream ss;
+  ss << res;
+  limitPtr->response = ss.str();
+  res.keep_alive(false);
+  ss.str("");
+  ss << res;
+  limitPtr->closeResponse = ss.str();
+  return limitPtr;
+}
+
+int ServerRateLimit::setLimit(double perSecond, double burst) {
+  if (perSecond <= 0) {
+    globalLimitPtr.reset();
+    return 0;
+  }
+  globalLimitPtr = newLimit(perSecond, burst);
+  return 0;
+}
+
+int ServerRateLimit::routeAdd(std::string method, std::string path,
+                              double perSecond, double burst) {
+  if (perSecond <= 0) {
+    logStatus("::ServerRateLimit::routeAdd",
+              "ERROR: rate limit needs a positive rate");
+    return -1;
+  }
+  auto limitPtr = newLimit(perSecond, burst);
+  limitPtr->method = method;
+  limitPtr->prefixFlag = !path.empty() && path.back() == '*';
+  if (limitPtr->prefixFlag) {
+    path.pop_back();
+  }
+  limitPtr->path = path;
+  routeLimitList.push_back(std::move(limitPtr));
+  return 0;
+}
+
+bool ServerRateLimit::take(limit &limit_, const std::string &address,
+                           std::chrono::steady_clock::time_point now) {
+  shard &shard_ =
+      limit_.shardList[std::hash<std::string>{}(address) % shardNum];
+  const std::lock_guard<std::mutex> lock(shard_.shardMutex);
+
+  // drop the buckets that refilled completely, a new bucket starts full
+  if (now - shard_.sweepTime > std::max<std::chrono::duration<double>>(
+                                   limit_.fillTime, std::chrono::seconds(10))) {
+    shard_.sweepTime = now;
+    for (auto it = shard_.bucketMap.begin(); it != shard_.bucketMap.end();) {
+      if (now - it->second.refillTime >= limit_.fillTime) {
+        it = shard_.bucketMap.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+
+  auto it = shard_.bucketMap.find(address);
+  if (it == shard_.bucketMap.end()) {
+    shard_.bucketMap.emplace(address, bucket{limit_.burst - 1, now});
+    return true;
+  }
+  bucket &bucket_ = it->second;
+  std::chrono::duration<double> elapsed = now - bucket_.refillTime;
+  bucket_.refillTime = now;
+  bucket_.tokens = std::min(limit_.burst,
+                            bucket_.tokens + elapsed.count() * limit_.perSecond);
+  if (bucket_.tokens < 1) {
+    return false;
+  }
+  bucket_.tokens -= 1;
+  return true;
+}
+
+ServerRateLimit::limit *
+ServerRateLimit::findRouteLimit(boost::beast::string_view method,
+                                boost::beast::string_view path) {
+  limit *bestPtr = nullptr;
+  for (auto &limitPtr : routeLimitList) {
+    if (limitPtr->method != "*" && method != limitPtr->method) {
+      continue;
+    }
+    if (limitPtr->prefixFlag) {
+      boost::beast::string_view prefix = limitPtr->path;
+      bool prefixMatch = path.substr(0, prefix.size()) == prefix;
+      // "/api/*" also covers "/api"
+      bool dirMatch = !prefix.empty() && prefix.back() == '/' &&
+                      path == prefix.substr(0, prefix.size() - 1);
+      if (!prefixMatch && !dirMatch) {
+        continue;
+      }
+    } else if (path != limitPtr->path) {
+      continue;
+    }
+    // an exact path wins over prefixes and a longer prefix over a shorter one
+    if (bestPtr && (limitPtr->prefixFlag != bestPtr->prefixFlag
+                        ? limitPtr->prefixFlag
+                        : limitPtr->path.size() <= bestPtr->path.size())) {
+      continue;
+    }
+    bestPtr = limitPtr.get();
+  }
+  return bestPtr;
+}
+
+const std::string *ServerRateLimit::check(const std::string &address,
+                                          boost::beast::string_view method,
+                                          boost::beast::string_view path,
+                                          bool closeFlag) {
+  if (!globalLimitPtr && routeLimitList.empty()) {
+    return nullptr;
+  }
+  auto now = std::chrono::steady_clock::now();
+  limit *limitPtr = nullptr;
+  if (globalLimitPtr && !take(*globalLimitPtr, address, now)) {
+    limitPtr = globalLimitPtr.get();
+  } else if (!routeLimitList.empty()) {
+    limit *routeLimitPtr = findRouteLimit(method, path);
+    if (routeLimitPtr && !take(*routeLimitPtr, address, now)) {
+      limitPtr = routeLimitPtr;
+    }
+  }
+  if (!limitPtr) {
+    return nullptr;
+  }
+  return closeFlag ? &limitPtr->closeResponse : &limitPtr->response;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
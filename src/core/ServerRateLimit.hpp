@@ -0,0 +1,103 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_SERVER_RATE_LIMIT_H
+#define BOOKFILER_MODULE_HTTP_HTTP_SERVER_RATE_LIMIT_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/beast/core/string.hpp>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Token buckets per client address. Every request takes a token, a bucket
+ * holds at most burst tokens and gains perSecond tokens a second. Buckets
+ * are refilled when they are used and a full bucket is dropped, so idle
+ * clients cost no memory. The buckets of a limit are split into shards with
+ * their own lock so the io threads rarely wait for each other.
+ */
+class ServerRateLimit {
+private:
+  static constexpr std::size_t shardNum = 16;
+  class bucket {
+  public:
+    double tokens;
+    std::chrono::steady_clock::time_point refillTime;
+  };
+  class shard {
+  public:
+    std::mutex shardMutex;
+    std::unordered_map<std::string, bucket> bucketMap;
+    std::chrono::steady_clock::time_point sweepTime;
+  };
+  class limit {
+  public:
+    // "*" for any method
+    std::string method;
+    // the path without the trailing "*" of a prefix route
+    std::string path;
+    bool prefixFlag;
+    double perSecond, burst;
+    // seconds until an empty bucket is full again
+    std::chrono::duration<double> fillTime;
+    // precomputed 429 answers, keep-alive and closing
+    std::string response, closeResponse;
+    std::array<shard, shardNum> shardList;
+  };
+  std::unique_ptr<limit> globalLimitPtr;
+  std::vector<std::unique_ptr<limit>> routeLimitList;
+  std::unique_ptr<limit> newLimit(double perSecond, double burst);
+  /* Takes a token from the bucket of the address, false if it is empty */
+  bool take(limit &, const std::string &address,
+            std::chrono::steady_clock::time_point now);
+  limit *findRouteLimit(boost::beast::string_view method,
+                        boost::beast::string_view path);
+
+public:
+  ServerRateLimit();
+  ~ServerRateLimit();
+  /* Limits every request of a client address, perSecond 0 disables it.
+   * Must not be called once the server runs.
+   */
+  int setLimit(double perSecond, double burst);
+  /* Limits the requests of a client address to matching routes on top of
+   * the limit of every request. Paths match like proxy routes.
+   * Must not be called once the server runs.
+   */
+  int routeAdd(std::string method, std::string path, double perSecond,
+               double burst);
+  /* Returns nullptr if the request may be answered, otherwise the 429
+   * response to write. closeFlag selects the answer closing the connection.
+   */
+  const std::string *check(const std::string &address,
+                           boost::beast::string_view method,
+                           boost::beast::string_view path, bool closeFlag);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_SERVER_RATE_LIMIT_H
@@ -54,6 +54,113 @@ int RouteImpl::add(
   return 0;
 }
 
+int RouteImpl::proxyAdd(std::string method, std::string path, int priority,
+                        std::string upstreamName) {
+  std::stringstream ss;
+  ss << "START\nmethod=" << method << " path=" << path
+     << " priority=" << priority << " proxy=" << upstreamName;
+  logStatus("::RouteImpl::proxyAdd", ss.str());
+  RouteProxy routeProxy;
+  routeProxy.method = method;
+  routeProxy.prefixFlag = !path.empty() && path.back() == '*';
+  if (routeProxy.prefixFlag) {
+    path.pop_back();
+  }
+  routeProxy.path = path;
+  routeProxy.priority = priority;
+  routeProxy.upstreamName = upstreamName;
+  proxyList.push_back(routeProxy);
+  return 0;
+}
+
+std::optional<std::string>
+RouteImpl::findProxy(boost::beast::string_view method,
+                     boost::beast::string_view path) {
+  const RouteProxy *bestPtr = nullptr;
+  for (auto &routeProxy : proxyList) {
+    if (routeProxy.method != "*" && method != routeProxy.method) {
+      continue;
+    }
+    if (routeProxy.prefixFlag) {
+      boost::beast::string_view prefix = routeProxy.path;
+      bool prefixMatch = path.substr(0, prefix.size()) == prefix;
+      // "/api/*" also covers "/api"
+      bool dirMatch = !prefix.empty() && prefix.back() == '/' &&
+                      path == prefix.substr(0, prefix.size() - 1);
+      if (!prefixMatch && !dirMatch) {
+        continue;
+      }
+    } else if (path != routeProxy.path) {
+      continue;
+    }
+    if (bestPtr) {
+      if (bestPtr->prefixFlag != routeProxy.prefixFlag) {
+        if (routeProxy.prefixFlag) {
+          continue;
+        }
+      } else if (bestPtr->path.size() != routeProxy.path.size()) {
+        if (routeProxy.path.size() < bestPtr->path.size()) {
+          continue;
+        }
+      } else if (routeProxy.priority <= bestPtr->priority) {
+        continue;
+      }
+    }
+    bestPtr = &routeProxy;
+  }
+  if (!bestPtr) {
+    return {};
+  }
+  return bestPtr->upstreamName;
+}
+
+int RouteImpl::cacheAdd(std::string path, std::chrono::milliseconds ttl,
+                        std::vector<std::string> varyList) {
+  std::stringstream ss;
+  ss << "START\npath=" << path << " ttl=" << ttl.count();
+  logStatus("::RouteImpl::cacheAdd", ss.str());
+  RouteCache routeCache;
+  routeCache.ttl = ttl;
+  routeCache.varyList = std::move(varyList);
+  routeCacheMap[path] = std::move(routeCache);
+  return 0;
+}
+
+const std::string &RouteImpl::findGetPath(const std::string &path) {
+  static const std::string anyPath = "*";
+  // an exact path before "*"
+  if (routeGetMap.find(path) != routeGetMap.end()) {
+    return path;
+  }
+  return anyPath;
+}
+
+const RouteCache *RouteImpl::findCache(const std::string &path) {
+  if (routeCacheMap.empty()) {
+    return nullptr;
+  }
+  auto it = routeCacheMap.find(findGetPath(path));
+  if (it == routeCacheMap.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+int RouteImpl::etagAdd(std::string path) {
+  std::stringstream ss;
+  ss << "START\npath=" << path;
+  logStatus("::RouteImpl::etagAdd", ss.str());
+  routeEtagSet.insert(path);
+  return 0;
+}
+
+bool RouteImpl::findEtag(const std::string &path) {
+  if (routeEtagSet.empty()) {
+    return false;
+  }
+  return routeEtagSet.count(findGetPath(path)) > 0;
+}
+
 int RouteImpl::doGetSignal(std::string path, std::shared_ptr<RequestImpl> req,
                            std::shared_ptr<ResponseImpl> res) {
   std::stringstream ss;
@@ -15,12 +15,15 @@
 // C++17
 //#include <filesystem>
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -53,6 +56,26 @@
 namespace bookfiler {
 namespace HTTP {
 
+/* A route answered by an upstream server instead of a route function */
+class RouteProxy {
+public:
+  // "*" for any method
+  std::string method;
+  // the path without the trailing "*" of a prefix route
+  std::string path;
+  bool prefixFlag;
+  int priority;
+  std::string upstreamName;
+};
+
+/* A GET route whose bodies are kept in the server cache */
+class RouteCache {
+public:
+  std::chrono::milliseconds ttl;
+  // request headers that are part of the cache key
+  std::vector<std::string> varyList;
+};
+
 class RouteImpl {
 private:
   /* Routes are stored in a map so that on average there is a log n search
@@ -62,6 +85,11 @@ private:
    */
   std::map<std::string, std::shared_ptr<routeSignalTypeInternal>> routePostMap,
       routeGetMap, routeAllMap;
+  std::vector<RouteProxy> proxyList;
+  std::map<std::string, RouteCache> routeCacheMap;
+  std::set<std::string> routeEtagSet;
+  /* The path of the GET route answering path, the same lookup as doSignal */
+  const std::string &findGetPath(const std::string &path);
 
 public:
   RouteImpl();
@@ -75,6 +103,31 @@ public:
   int add(std::string path, int priority,
           routeFunctionTypeInternal routeFunction,
           std::map<std::string, std::shared_ptr<routeSignalTypeInternal>> &);
+  /* Forwards matching requests to the upstream. A path ending in "*" matches
+   * every path starting with the part before it, so "/api/" followed by "*"
+   * matches "/api/users" and "/api". Must not be called once the server runs.
+   */
+  int proxyAdd(std::string method, std::string path, int priority,
+               std::string upstreamName);
+  /* Returns the upstream of the proxy route matching the request. An exact
+   * path wins over prefixes and a longer prefix over a shorter one, then the
+   * higher priority wins.
+   */
+  std::optional<std::string> findProxy(boost::beast::string_view method,
+                                       boost::beast::string_view path);
+  /* Caches the bodies of the GET route at path for ttl. varyList names
+   * request headers that select different bodies. Must not be called once
+   * the server runs.
+   */
+  int cacheAdd(std::string path, std::chrono::milliseconds ttl,
+               std::vector<std::string> varyList);
+  /* Returns the cache settings of the GET route answering path */
+  const RouteCache *findCache(const std::string &path);
+  /* Adds an ETag to the responses of the GET route at path and answers
+   * If-None-Match with 304. Must not be called once the server runs.
+   */
+  int etagAdd(std::string path);
+  bool findEtag(const std::string &path);
   int doGetSignal(std::string path, std::shared_ptr<RequestImpl> req,
                   std::shared_ptr<ResponseImpl> res);
   int doSignal(
@@ -0,0 +1,190 @@
+/*
+ * @name BookFiler Module - HTTP
+ * @author Branden Lee
+ * @version 1.01
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+// C++17
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+// Local Project
+#include "ServerSocket.hpp"
+#include "Util.hpp"
+#include "json.hpp"
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+ServerSocketOptions::ServerSocketOptions() {
+  backlog = boost::asio::socket_base::max_listen_connections;
+  // small responses go out without waiting for an ACK
+  noDelay = true;
+  keepAlive = false;
+  deferAccept = fastOpenQueue = 0;
+  receiveBufferSize = sendBufferSize = 0;
+  keepAliveIdle = keepAliveInterval = keepAliveCount = 0;
+  notSentLowat = busyPoll = 0;
+}
+
+ServerSocketOptions::~ServerSocketOptions() {}
+
+int ServerSocketOptions::extractSettings(const rapidjson::Value &socketJson) {
+  if (!socketJson.IsObject()) {
+    logStatus("::ServerSocketOptions::extractSettings",
+              "ERROR: \"socket\" is not an object");
+    return -1;
+  }
+  JsonImpl json;
+  auto getInt = [&](const char *key, int &value) {
+    auto valueOpt = json.getMemberInt(socketJson, key);
+    if (valueOpt) {
+      value = std::max<int>(0, *valueOpt);
+    }
+  };
+  auto getFlag = [&](const char *key, bool &value) {
+    if (socketJson.HasMember(key) && socketJson[key].IsBool()) {
+      value = socketJson[key].GetBool();
+    } else {
+      auto valueOpt = json.getMemberInt(socketJson, key);
+      if (valueOpt) {
+        value = *valueOpt != 0;
+      }
+    }
+  };
+  getInt("backlog", backlog);
+  getFlag("noDelay", noDelay);
+  getFlag("keepAlive", keepAlive);
+  getInt("deferAccept", deferAccept);
+  getInt("fastOpenQueue", fastOpenQueue);
+  getInt("receiveBufferSize", receiveBufferSize);
+  getInt("sendBufferSize", sendBufferSize);
+  getInt("keepAliveIdle", keepAliveIdle);
+  getInt("keepAliveInterval", keepAliveInterval);
+  getInt("keepAliveCount", keepAliveCount);
+  getInt("notSentLowat", notSentLowat);
+  getInt("busyPoll", busyPoll);
+  if (backlog == 0) {
+    backlog = boost::asio::socket_base::max_listen_connections;
+  }
+  return 0;
+}
+
+int ServerSocketOptions::setInt(int fd, int level, int name, int value,
+                                const char *what) {
+#ifndef _WIN32
+  if (::setsockopt(fd, level, name, &value, sizeof(value)) != 0) {
+    logStatus("::ServerSocketOptions::setInt",
+              std::string("ERROR: ") + what + ": " + std::strerror(errno));
+    return -1;
+  }
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+int ServerSocketOptions::applyListen(boost::asio::ip::tcp::acceptor &acceptor) {
+  boost::system::error_code ec;
+  int rc = 0;
+  // accepted sockets inherit the buffer sizes, the receive window scale is
+  // fixed by the SYN so it has to be set before listen
+  if (receiveBufferSize > 0) {
+    acceptor.set_option(
+        boost::asio::socket_base::receive_buffer_size(receiveBufferSize), ec);
+    if (ec) {
+      logStatus("::ServerSocketOptions::applyListen", "receive_buffer_size",
+                ec);
+      rc = -1;
+    }
+  }
+  if (sendBufferSize > 0) {
+    acceptor.set_option(
+        boost::asio::socket_base::send_buffer_size(sendBufferSize), ec);
+    if (ec) {
+      logStatus("::ServerSocketOptions::applyListen", "send_buffer_size", ec);
+      rc = -1;
+    }
+  }
+#ifdef __linux__
+  int fd = acceptor.native_handle();
+  // wake the acceptor only once the request data arrived
+  if (deferAccept > 0 &&
+      setInt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, deferAccept,
+             "TCP_DEFER_ACCEPT") < 0) {
+    rc = -1;
+  }
+#ifdef TCP_FASTOPEN
+  if (fastOpenQueue > 0 && setInt(fd, IPPROTO_TCP, TCP_FASTOPEN, fastOpenQueue,
+                                  "TCP_FASTOPEN") < 0) {
+    rc = -1;
+  }
+#endif
+#endif
+  return rc;
+}
+
+int ServerSocketOptions::applyAccepted(boost::asio::ip::tcp::socket &socket) {
+  boost::system::error_code ec;
+  int rc = 0;
+  if (noDelay) {
+    socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    if (ec) {
+      logStatus("::ServerSocketOptions::applyAccepted", "no_delay", ec);
+      rc = -1;
+    }
+  }
+  if (keepAlive) {
+    socket.set_option(boost::asio::socket_base::keep_alive(true), ec);
+    if (ec) {
+      logStatus("::ServerSocketOptions::applyAccepted", "keep_alive", ec);
+      rc = -1;
+    }
+  }
+#ifdef __linux__
+  int fd = socket.native_handle();
+  if (keepAlive) {
+    if (keepAliveIdle > 0 && setInt(fd, IPPROTO_TCP, TCP_KEEPIDLE,
+                                    keepAliveIdle, "TCP_KEEPIDLE") < 0) {
+      rc = -1;
+    }
+    if (keepAliveInterval > 0 &&
+        setInt(fd, IPPROTO_TCP, TCP_KEEPINTVL, keepAliveInterval,
+               "TCP_KEEPINTVL") < 0) {
+      rc = -1;
+    }
+    if (keepAliveCount > 0 && setInt(fd, IPPROTO_TCP, TCP_KEEPCNT,
+                                     keepAliveCount, "TCP_KEEPCNT") < 0) {
+      rc = -1;
+    }
+  }
+#ifdef TCP_NOTSENT_LOWAT
+  if (notSentLowat > 0 && setInt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                                 notSentLowat, "TCP_NOTSENT_LOWAT") < 0) {
+    rc = -1;
+  }
+#endif
+#ifdef SO_BUSY_POLL
+  if (busyPoll > 0 &&
+      setInt(fd, SOL_SOCKET, SO_BUSY_POLL, busyPoll, "SO_BUSY_POLL") < 0) {
+    rc = -1;
+  }
+#endif
+#endif
+  return rc;
+}
+
+} // namespace HTTP
+} // namespace bookfiler
@@ -0,0 +1,73 @@
+/*
+ * @name BookFiler Module - HTTP w/ Curl
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief HTTP module for BookFiler™ applications.
+ */
+
+#ifndef BOOKFILER_MODULE_HTTP_HTTP_SERVER_SOCKET_H
+#define BOOKFILER_MODULE_HTTP_HTTP_SERVER_SOCKET_H
+
+// config
+#include "config.hpp"
+
+// C++17
+#include <string>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/document.h>
+
+/* boost 1.72.0
+ * License: Boost Software License (similar to BSD and MIT)
+ */
+#include <boost/asio/ip/tcp.hpp>
+
+/*
+ * bookfiler - HTTP
+ */
+namespace bookfiler {
+namespace HTTP {
+
+/* Tuning of the listening socket and the sockets it accepts, read from the
+ * "socket" object of the server settings. 0 keeps the system default.
+ * deferAccept, fastOpenQueue, the keep-alive timing, notSentLowat and
+ * busyPoll only exist on Linux and are ignored elsewhere. An option the
+ * system rejects is logged and skipped.
+ */
+class ServerSocketOptions {
+private:
+  /* setsockopt with an int value on the native handle */
+  int setInt(int fd, int level, int name, int value, const char *what);
+
+public:
+  ServerSocketOptions();
+  ~ServerSocketOptions();
+  int backlog;
+  bool noDelay, keepAlive;
+  // seconds
+  int deferAccept;
+  int fastOpenQueue;
+  // bytes
+  int receiveBufferSize, sendBufferSize;
+  // seconds, seconds, probes
+  int keepAliveIdle, keepAliveInterval, keepAliveCount;
+  // bytes of unsent data before the socket stops being writable
+  int notSentLowat;
+  // microseconds
+  int busyPoll;
+  int extractSettings(const rapidjson::Value &);
+  /* Applied after bind and before listen */
+  int applyListen(boost::asio::ip::tcp::acceptor &);
+  /* Applied to every accepted socket */
+  int applyAccepted(boost::asio::ip::tcp::socket &);
+};
+
+} // namespace HTTP
+} // namespace bookfiler
+
+#endif
+// end BOOKFILER_MODULE_HTTP_HTTP_SERVER_SOCKET_H
@@ -15,7 +15,18 @@
 namespace bookfiler {
 namespace HTTP {
 
-ServerState::ServerState() {}
+ServerState::ServerState() {
+  proxyPtr = std::make_shared<ServerProxy>();
+  rateLimitPtr = std::make_shared<ServerRateLimit>();
+  cachePtr = std::make_shared<ServerCache>();
+  socketOptionsPtr = std::make_shared<ServerSocketOptions>();
+  // the Beast defaults
+  headerLimit = 8 * 1024;
+  bodyLimit = 1024 * 1024;
+  headerCountLimit = 100;
+  bufferLimit = 64 * 1024;
+  idleBufferSize = 8 * 1024;
+}
 ServerState::~ServerState() {}
 
 } // namespace HTTP
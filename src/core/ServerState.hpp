@@ -31,7 +31,11 @@
 #include <boost/asio/ip/address.hpp>
 
 // Local Project
+#include "ServerCache.hpp"
 #include "ServerConnection.hpp"
+#include "ServerProxy.hpp"
+#include "ServerRateLimit.hpp"
+#include "ServerSocket.hpp"
 
 /*
  * bookfiler - HTTP
@@ -50,6 +54,19 @@ public:
   boost::asio::ip::address address;
   std::string docRootStr, addressStr;
   std::vector<std::shared_ptr<Connection>> connectionList;
+  std::shared_ptr<ServerProxy> proxyPtr;
+  std::shared_ptr<ServerRateLimit> rateLimitPtr;
+  std::shared_ptr<ServerCache> cachePtr;
+  std::shared_ptr<ServerSocketOptions> socketOptionsPtr;
+  /* Bound the memory of a connection. headerLimit and headerCountLimit
+   * apply to every request, bodyLimit to the bodies of routes that are not
+   * proxied. bufferLimit caps the read buffer while a request is read and
+   * idleBufferSize the capacity kept between requests.
+   */
+  std::uint32_t headerLimit;
+  std::size_t headerCountLimit;
+  std::uint64_t bodyLimit;
+  std::size_t bufferLimit, idleBufferSize;
 };
 
 } // namespace HTTP
@@ -6,6 +6,9 @@
  * @brief HTTP module for BookFiler™ applications.
  */
 
+// C++17
+#include <cstdio>
+
 // Local Project
 #include "ServerUtil.hpp"
 
@@ -69,5 +72,134 @@ beast::string_view mime_type(beast::string_view path) {
   return "application/text";
 }
 
+namespace {
+
+const std::uint64_t xxhPrime1 = 0x9E3779B185EBCA87ULL;
+const std::uint64_t xxhPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const std::uint64_t xxhPrime3 = 0x165667B19E3779F9ULL;
+const std::uint64_t xxhPrime4 = 0x85EBCA77C2B2AE63ULL;
+const std::uint64_t xxhPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl64(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// little endian like the reference implementation
+inline std::uint64_t read64(const unsigned char *p) {
+  std::uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+inline std::uint32_t read32(const unsigned char *p) {
+  return static_cast<std::uint32_t>(p[0]) |
+         static_cast<std::uint32_t>(p[1]) << 8 |
+         static_cast<std::uint32_t>(p[2]) << 16 |
+         static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+inline std::uint64_t xxhRound(std::uint64_t acc, std::uint64_t input) {
+  acc += input * xxhPrime2;
+  acc = rotl64(acc, 31);
+  return acc * xxhPrime1;
+}
+
+inline std::uint64_t xxhMerge(std::uint64_t acc, std::uint64_t val) {
+  acc ^= xxhRound(0, val);
+  return acc * xxhPrime1 + xxhPrime4;
+}
+
+} // namespace
+
+std::uint64_t hashXxh64(const char *data, std::size_t size,
+                        std::uint64_t seed) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  const unsigned char *end = p + size;
+  std::uint64_t h;
+  if (size >= 32) {
+    // four independent lanes of 8 bytes
+    std::uint64_t v1 = seed + xxhPrime1 + xxhPrime2;
+    std::uint64_t v2 = seed + xxhPrime2;
+    std::uint64_t v3 = seed;
+    std::uint64_t v4 = seed - xxhPrime1;
+    const unsigned char *limit = end - 32;
+    do {
+      v1 = xxhRound(v1, read64(p));
+      v2 = xxhRound(v2, read64(p + 8));
+      v3 = xxhRound(v3, read64(p + 16));
+      v4 = xxhRound(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = xxhMerge(h, v1);
+    h = xxhMerge(h, v2);
+    h = xxhMerge(h, v3);
+    h = xxhMerge(h, v4);
+  } else {
+    h = seed + xxhPrime5;
+  }
+  h += static_cast<std::uint64_t>(size);
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxhRound(0, read64(p));
+    h = rotl64(h, 27) * xxhPrime1 + xxhPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<std::uint64_t>(read32(p)) * xxhPrime1;
+    h = rotl64(h, 23) * xxhPrime2 + xxhPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= (*p) * xxhPrime5;
+    h = rotl64(h, 11) * xxhPrime1;
+  }
+  // avalanche
+  h ^= h >> 33;
+  h *= xxhPrime2;
+  h ^= h >> 29;
+  h *= xxhPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::string bodyEtag(beast::string_view body) {
+  char etag[19];
+  std::snprintf(etag, sizeof(etag), "\"%016llx\"",
+                static_cast<unsigned long long>(
+                    hashXxh64(body.data(), body.size())));
+  return etag;
+}
+
+bool etagMatch(beast::string_view ifNoneMatch, beast::string_view etag) {
+  // the opaque tag without W/
+  auto opaque = [](beast::string_view tag) {
+    if (tag.substr(0, 2) == "W/") {
+      tag.remove_prefix(2);
+    }
+    return tag;
+  };
+  beast::string_view etagOpaque = opaque(etag);
+  std::size_t pos = 0;
+  while (pos < ifNoneMatch.size()) {
+    std::size_t comma = ifNoneMatch.find(',', pos);
+    if (comma == beast::string_view::npos) {
+      comma = ifNoneMatch.size();
+    }
+    beast::string_view tag = ifNoneMatch.substr(pos, comma - pos);
+    while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+      tag.remove_prefix(1);
+    }
+    while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+      tag.remove_suffix(1);
+    }
+    if (tag == "*" || opaque(tag) == etagOpaque) {
+      return true;
+    }
+    pos = comma + 1;
+  }
+  return false;
+}
+
 } // namespace HTTP
 } // namespace bookfiler
@@ -15,6 +15,7 @@
 // C++17
 //#include <filesystem>
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
@@ -115,6 +116,16 @@ using routeSignalTypeInternal =
 // Return a reasonable mime type based on the extension of a file.
 beast::string_view mime_type(beast::string_view path);
 
+/* XXH64 of the data, a fast non-cryptographic hash */
+std::uint64_t hashXxh64(const char *data, std::size_t size,
+                        std::uint64_t seed = 0);
+/* A strong entity tag of the body, its hash in quotes */
+std::string bodyEtag(beast::string_view body);
+/* Whether the If-None-Match list matches the entity tag. If-None-Match
+ * compares weakly, so W/"x" matches "x".
+ */
+bool etagMatch(beast::string_view ifNoneMatch, beast::string_view etag);
+
 } // namespace HTTP
 } // namespace bookfiler
 
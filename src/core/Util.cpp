@@ -107,5 +107,36 @@ void logConnectionStatus(unsigned int socketId, std::string functionStr,
 
 std::string readFile(std::string path) { return ::bookfiler::readFile(path); }
 
+std::optional<std::chrono::system_clock::time_point>
+parseHttpDate(std::string_view dateStr) {
+  std::tm tm = {};
+  std::istringstream ss{std::string(dateStr)};
+  ss.imbue(std::locale::classic());
+  ss >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+  if (ss.fail()) {
+    return std::nullopt;
+  }
+  // the date is UTC, mktime would apply the local time zone
+#if defined(_WIN32)
+  return std::chrono::system_clock::from_time_t(_mkgmtime(&tm));
+#else
+  return std::chrono::system_clock::from_time_t(timegm(&tm));
+#endif
+}
+
+std::string formatHttpDate(std::chrono::system_clock::time_point timePoint) {
+  std::time_t time = std::chrono::system_clock::to_time_t(timePoint);
+  std::tm tm = {};
+#if defined(_WIN32)
+  gmtime_s(&tm, &time);
+#else
+  gmtime_r(&time, &tm);
+#endif
+  std::ostringstream ss;
+  ss.imbue(std::locale::classic());
+  ss << std::put_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+  return ss.str();
+}
+
 } // namespace HTTP
 } // namespace bookfiler
@@ -13,11 +13,16 @@
 #include "config.hpp"
 
 // C++17
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
 
 /* boost 1.72.0
@@ -55,6 +60,10 @@ void logConnectionStatus(unsigned int, std::string functionStr,
 void logConnectionStatus(unsigned int, std::string functionStr, std::string msg,
                          boost::system::error_code ec);
 std::string readFile(std::string path);
+/* Parses an IMF-fixdate such as "Sun, 06 Nov 1994 08:49:37 GMT" */
+std::optional<std::chrono::system_clock::time_point>
+parseHttpDate(std::string_view);
+std::string formatHttpDate(std::chrono::system_clock::time_point);
 
 } // namespace HTTP
 } // namespace bookfiler
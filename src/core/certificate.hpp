@@ -38,6 +38,7 @@
 #include <openssl/buffer.h>
 #include <openssl/conf.h>
 #include <openssl/dh.h>
+#include <openssl/ec.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/objects.h>
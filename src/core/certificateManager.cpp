@@ -6,11 +6,6 @@
  * @brief HTTP module for BookFiler™ applications.
  */
 
-/* boost 1.72.0
- * License: Boost Software License (similar to BSD and MIT)
- */
-#include <boost/core/ignore_unused.hpp>
-
 // Local Project
 #include "certificateManager.hpp"
 
@@ -29,6 +24,70 @@ int ManagerImpl::setSettingsDoc(
   return 0;
 }
 
+EVP_PKEY *ManagerImpl::newPrivateKey(const std::string &keyType) {
+  if (keyType == "rsa") {
+    EVP_PKEY *privateKey = EVP_PKEY_new();
+    std::unique_ptr<RSA, void (*)(RSA *)> rsaPtr{RSA_new(), RSA_free};
+    std::unique_ptr<BIGNUM, void (*)(BIGNUM *)> bigNumberPtr{BN_new(),
+                                                             BN_free};
+    BN_set_word(bigNumberPtr.get(), RSA_F4);
+    if (RSA_generate_key_ex(rsaPtr.get(), RSA_KEY_LENGTH, bigNumberPtr.get(),
+                            nullptr) <= 0) {
+      EVP_PKEY_free(privateKey);
+      return nullptr;
+    }
+    // The RSA structure will be automatically freed when the EVP_PKEY
+    // structure is freed.
+    EVP_PKEY_assign(privateKey, EVP_PKEY_RSA,
+                    reinterpret_cast<char *>(rsaPtr.release()));
+    return privateKey;
+  }
+
+  int keyId;
+  if (keyType == "ecdsa") {
+    keyId = EVP_PKEY_EC;
+  } else if (keyType == "ed25519") {
+    keyId = EVP_PKEY_ED25519;
+  } else {
+    return nullptr;
+  }
+  std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX *)> ctxPtr{
+      EVP_PKEY_CTX_new_id(keyId, nullptr), EVP_PKEY_CTX_free};
+  if (!ctxPtr || EVP_PKEY_keygen_init(ctxPtr.get()) <= 0) {
+    return nullptr;
+  }
+  if (keyId == EVP_PKEY_EC &&
+      (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctxPtr.get(),
+                                              NID_X9_62_prime256v1) <= 0 ||
+       EVP_PKEY_CTX_set_ec_param_enc(ctxPtr.get(), OPENSSL_EC_NAMED_CURVE) <=
+           0)) {
+    return nullptr;
+  }
+  EVP_PKEY *privateKey = nullptr;
+  if (EVP_PKEY_keygen(ctxPtr.get(), &privateKey) <= 0) {
+    return nullptr;
+  }
+  return privateKey;
+}
+
+const EVP_MD *ManagerImpl::signDigest(EVP_PKEY *privateKey) {
+  if (EVP_PKEY_base_id(privateKey) == EVP_PKEY_ED25519) {
+    return nullptr;
+  }
+  return EVP_sha256();
+}
+
+void ManagerImpl::copyKeyType(std::shared_ptr<rapidjson::Document> from,
+                              std::shared_ptr<rapidjson::Document> to) {
+  if (!from || !from->IsObject() || !from->HasMember("keyType") ||
+      !(*from)["keyType"].IsString()) {
+    return;
+  }
+  rapidjson::Value keyTypeValue((*from)["keyType"].GetString(),
+                                to->GetAllocator());
+  to->AddMember("keyType", keyTypeValue, to->GetAllocator());
+}
+
 int ManagerImpl::newCertificate(
     std::shared_ptr<Certificate> &certPtr,
     std::shared_ptr<rapidjson::Document> optionsDoc) {
@@ -39,6 +98,7 @@ int ManagerImpl::newCertificate(
   std::string ouStr = "OU";
   std::string cityStr = "L";
   std::string stateStr = "S";
+  std::string keyTypeStr = "rsa";
 
   int rc = 0;
 
@@ -49,6 +109,11 @@ int ManagerImpl::newCertificate(
         << "::ManagerImpl::newCertificate WARNING:\nSettings document invalid"
         << std::endl;
   } else {
+    char memberName08[] = "keyType";
+    if (optionsDoc->HasMember(memberName08) &&
+        (*optionsDoc)[memberName08].IsString()) {
+      keyTypeStr = (*optionsDoc)[memberName08].GetString();
+    }
     char memberName01[] = "daysValid";
     if (optionsDoc->HasMember(memberName01) &&
         (*optionsDoc)[memberName01].IsInt()) {
@@ -90,41 +155,34 @@ int ManagerImpl::newCertificate(
   std::shared_ptr<CertificateImpl> certImplPtr =
       std::make_shared<CertificateNativeImpl>();
   certImplPtr->certX509 = X509_new();
-  certImplPtr->privateKey = EVP_PKEY_new();
-  certImplPtr->dhKey = DH_new();
-
-  // Generate RSA Key
-  std::unique_ptr<RSA, void (*)(RSA *)> rsaPtr{RSA_new(), RSA_free};
-  std::unique_ptr<BIGNUM, void (*)(BIGNUM *)> bigNumberPtr{BN_new(), BN_free};
-  BN_set_word(bigNumberPtr.get(), RSA_F4);
-  rc = RSA_generate_key_ex(rsaPtr.get(), RSA_KEY_LENGTH, bigNumberPtr.get(),
-                           nullptr);
-  if (rc < 0) {
-    std::cout << moduleCode
-              << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
-              << std::endl;
+  certImplPtr->privateKey = newPrivateKey(keyTypeStr);
+  if (!certImplPtr->privateKey) {
+    std::cout << moduleCode << "::ManagerImpl::newCertificate newPrivateKey "
+              << keyTypeStr << " ERROR" << std::endl;
     return -1;
   }
-  EVP_PKEY_assign(certImplPtr->privateKey, EVP_PKEY_RSA,
-                  reinterpret_cast<char *>(rsaPtr.release()));
 
-  // Generate DH Key
-  if (!certImplPtr->dhKey) {
-    std::cout << moduleCode << "::ManagerImpl::newCertificate DH_new ERROR"
-              << std::endl;
-  }
-  rc = DH_generate_parameters_ex(certImplPtr->dhKey, 2048, 2, nullptr);
-  if (rc < 0) {
-    std::cout << moduleCode
-              << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
-              << std::endl;
-    return -1;
+  // DHE only has cipher suites with RSA certificates, ECDSA and Ed25519
+  // certificates use ECDHE
+  if (keyTypeStr == "rsa") {
+    // Generate DH Key
+    certImplPtr->dhKey = DH_new();
+    if (!certImplPtr->dhKey) {
+      std::cout << moduleCode << "::ManagerImpl::newCertificate DH_new ERROR"
+                << std::endl;
+    }
+    rc = DH_generate_parameters_ex(certImplPtr->dhKey, 2048, 2, nullptr);
+    if (rc < 0) {
+      std::cout
+          << moduleCode
+          << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
+          << std::endl;
+      return -1;
+    }
+    EVP_PKEY *evpDhKey = EVP_PKEY_new();
+    EVP_PKEY_assign_DH(evpDhKey, certImplPtr->dhKey);
   }
-  EVP_PKEY *evpDhKey = EVP_PKEY_new();
-  EVP_PKEY_assign_DH(evpDhKey, certImplPtr->dhKey);
 
-  // The RSA structure will be automatically freed when the EVP_PKEY
-  // structure is freed.
   ASN1_INTEGER_set(X509_get_serialNumber(certImplPtr->certX509), 5);
 
   X509_gmtime_adj(X509_get_notBefore(certImplPtr->certX509), 0); // now
@@ -167,7 +225,7 @@ int ManagerImpl::newCertificate(
   // certImplPtr->addExt(NID_netscape_comment, "example comment extension");
 
   X509_sign(certImplPtr->certX509, certImplPtr->privateKey,
-            EVP_sha256()); // some hash type here
+            signDigest(certImplPtr->privateKey));
 
   // return
   certPtr = std::dynamic_pointer_cast<Certificate>(certImplPtr);
@@ -181,6 +239,7 @@ int ManagerImpl::newRequest(std::shared_ptr<Certificate> &certPtr,
   std::string countryStr = "C";
   std::string companyStr = "O";
   std::string commonNameStr = "CN";
+  std::string keyTypeStr = "rsa";
 
   int rc = 0;
 
@@ -191,48 +250,45 @@ int ManagerImpl::newRequest(std::shared_ptr<Certificate> &certPtr,
         << "::ManagerImpl::newCertificate WARNING:\nSettings document invalid"
         << std::endl;
   } else {
-    // nothing
+    char memberName08[] = "keyType";
+    if (settingsDoc->HasMember(memberName08) &&
+        (*settingsDoc)[memberName08].IsString()) {
+      keyTypeStr = (*settingsDoc)[memberName08].GetString();
+    }
   }
 
   // Create certificate
   std::shared_ptr<CertificateImpl> certImplPtr =
       std::make_shared<CertificateNativeImpl>();
   certImplPtr->certReqX509 = X509_REQ_new();
-  certImplPtr->privateKey = EVP_PKEY_new();
-  certImplPtr->dhKey = DH_new();
-
-  // Generate RSA Key
-  std::unique_ptr<RSA, void (*)(RSA *)> rsaPtr{RSA_new(), RSA_free};
-  std::unique_ptr<BIGNUM, void (*)(BIGNUM *)> bigNumberPtr{BN_new(), BN_free};
-  BN_set_word(bigNumberPtr.get(), RSA_F4);
-  rc = RSA_generate_key_ex(rsaPtr.get(), RSA_KEY_LENGTH, bigNumberPtr.get(),
-                           nullptr);
-  if (rc < 0) {
-    std::cout << moduleCode
-              << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
-              << std::endl;
+  certImplPtr->privateKey = newPrivateKey(keyTypeStr);
+  if (!certImplPtr->privateKey) {
+    std::cout << moduleCode << "::ManagerImpl::newCertificate newPrivateKey "
+              << keyTypeStr << " ERROR" << std::endl;
     return -1;
   }
-  EVP_PKEY_assign(certImplPtr->privateKey, EVP_PKEY_RSA,
-                  reinterpret_cast<char *>(rsaPtr.release()));
 
-  // Generate DH Key
-  if (!certImplPtr->dhKey) {
-    std::cout << moduleCode << "::ManagerImpl::newCertificate DH_new ERROR"
-              << std::endl;
-  }
-  rc = DH_generate_parameters_ex(certImplPtr->dhKey, 2048, 2, nullptr);
-  if (rc < 0) {
-    std::cout << moduleCode
-              << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
-              << std::endl;
-    return -1;
+  // DHE only has cipher suites with RSA certificates, ECDSA and Ed25519
+  // certificates use ECDHE
+  if (keyTypeStr == "rsa") {
+    // Generate DH Key
+    certImplPtr->dhKey = DH_new();
+    if (!certImplPtr->dhKey) {
+      std::cout << moduleCode << "::ManagerImpl::newCertificate DH_new ERROR"
+                << std::endl;
+    }
+    rc = DH_generate_parameters_ex(certImplPtr->dhKey, 2048, 2, nullptr);
+    if (rc < 0) {
+      std::cout
+          << moduleCode
+          << "::ManagerImpl::newCertificate DH_generate_parameters_ex ERROR"
+          << std::endl;
+      return -1;
+    }
+    EVP_PKEY *evpDhKey = EVP_PKEY_new();
+    EVP_PKEY_assign_DH(evpDhKey, certImplPtr->dhKey);
   }
-  EVP_PKEY *evpDhKey = EVP_PKEY_new();
-  EVP_PKEY_assign_DH(evpDhKey, certImplPtr->dhKey);
 
-  // The RSA structure will be automatically freed when the EVP_PKEY
-  // structure is freed.
   X509_REQ_set_pubkey(certImplPtr->certReqX509, certImplPtr->privateKey);
   X509_REQ_set_version(certImplPtr->certReqX509, 2);
 
@@ -348,8 +404,12 @@ int ManagerImpl::signRequest(std::shared_ptr<Certificate> certPtr,
   // Add usual cert stuff
   X509_EXTENSION *ex = nullptr;
 
-  ex = X509V3_EXT_conf_nid(NULL, NULL, NID_key_usage,
-                           "digitalSignature, keyEncipherment, keyAgreement");
+  // only RSA keys encrypt, ECDSA and Ed25519 keys just sign
+  ex = X509V3_EXT_conf_nid(
+      NULL, NULL, NID_key_usage,
+      EVP_PKEY_base_id(certImplPtr->privateKey) == EVP_PKEY_RSA
+          ? "digitalSignature, keyEncipherment, keyAgreement"
+          : "digitalSignature");
   X509_add_ext(certImplPtr->certX509, ex, -1);
   X509_EXTENSION_free(ex);
 
@@ -363,9 +423,9 @@ int ManagerImpl::signRequest(std::shared_ptr<Certificate> certPtr,
   X509_add_ext(certImplPtr->certX509, ex, -1);
   X509_EXTENSION_free(ex);
 
-  rc =
-      X509_sign(certImplPtr->certX509, certCAImplPtr->privateKey, EVP_sha256());
-  if (rc < 0) {
+  rc = X509_sign(certImplPtr->certX509, certCAImplPtr->privateKey,
+                 signDigest(certCAImplPtr->privateKey));
+  if (rc <= 0) {
     std::cout << moduleCode << "::ManagerImpl::signRequest X509_sign ERROR"
               << std::endl;
     return -1;
@@ -381,9 +441,6 @@ int ManagerImpl::signRequest(std::shared_ptr<Certificate> certPtr,
 int ManagerImpl::newCertRootLocalhost(
     std::shared_ptr<Certificate> &certPtr,
     std::shared_ptr<rapidjson::Document> optionsDoc) {
-  // some macro options
-  boost::ignore_unused(optionsDoc);
-
   int rc = 0;
   std::shared_ptr<rapidjson::Document> optionsDoc2 =
       std::make_shared<rapidjson::Document>();
@@ -398,6 +455,7 @@ int ManagerImpl::newCertRootLocalhost(
   optionsDoc2->AddMember("OU", "bookfiler.com", optionsDoc2->GetAllocator());
   optionsDoc2->AddMember("city", "San Jose", optionsDoc2->GetAllocator());
   optionsDoc2->AddMember("state", "California", optionsDoc2->GetAllocator());
+  copyKeyType(optionsDoc, optionsDoc2);
   rc = newCertificate(certPtr, optionsDoc2);
   if (rc < 0) {
     return -1;
@@ -411,9 +469,6 @@ int ManagerImpl::newCertRootLocalhost(
 int ManagerImpl::newCertServerLocalhost(
     std::shared_ptr<Certificate> &certPtr,
     std::shared_ptr<rapidjson::Document> settingsDoc) {
-  // some macro options
-  boost::ignore_unused(settingsDoc);
-
   int rc = 0;
   std::shared_ptr<rapidjson::Document> settingsDoc2 =
       std::make_shared<rapidjson::Document>();
@@ -428,6 +483,7 @@ int ManagerImpl::newCertServerLocalhost(
   settingsDoc2->AddMember("OU", "localhost", settingsDoc2->GetAllocator());
   settingsDoc2->AddMember("city", "San Jose", settingsDoc2->GetAllocator());
   settingsDoc2->AddMember("state", "California", settingsDoc2->GetAllocator());
+  copyKeyType(settingsDoc, settingsDoc2);
   rc = newRequest(certPtr, settingsDoc2);
   if (rc < 0) {
     std::cout << moduleCode
@@ -552,5 +608,27 @@ int ManagerImpl::loadCertificate(std::shared_ptr<Certificate> &certPtr) {
   return 0;
 }
 
+int ManagerImpl::createX509StoreFromFile(std::string caInfoPath) {
+  std::shared_ptr<X509_STORE> newStorePtr(X509_STORE_new(), X509_STORE_free);
+  if (!newStorePtr) {
+    std::cout << moduleCode
+              << "::ManagerImpl::createX509StoreFromFile X509_STORE_new ERROR"
+              << std::endl;
+    return -1;
+  }
+  if (X509_STORE_load_locations(newStorePtr.get(), caInfoPath.c_str(),
+                                nullptr) != 1) {
+    std::cout << moduleCode
+              << "::ManagerImpl::createX509StoreFromFile "
+                 "X509_STORE_load_locations ERROR:\n"
+              << caInfoPath << std::endl;
+    return -1;
+  }
+  storePtr = newStorePtr;
+  return 0;
+}
+
+std::shared_ptr<X509_STORE> ManagerImpl::getX509Store() { return storePtr; }
+
 } // namespace certificate
 } // namespace bookfiler
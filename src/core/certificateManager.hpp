@@ -48,12 +48,21 @@ namespace certificate {
 
 class ManagerImpl : public Manager {
 private:
-  std::shared_ptr<X509_STORE> storePtr;
   std::shared_ptr<CertificateNativeImpl> certRootLocalhostPtr,
       certServerLocalhostPtr;
   std::shared_ptr<rapidjson::Value> settingsDoc;
+  /* Generates a key of keyType "rsa" (RSA_KEY_LENGTH bits), "ecdsa" (P-256)
+   * or "ed25519". Returns nullptr for an unknown type.
+   */
+  EVP_PKEY *newPrivateKey(const std::string &keyType);
+  /* The digest X509_sign needs for the key, none for Ed25519 */
+  const EVP_MD *signDigest(EVP_PKEY *);
+  /* Copies "keyType" of the options to the generated options */
+  void copyKeyType(std::shared_ptr<rapidjson::Document> from,
+                   std::shared_ptr<rapidjson::Document> to);
 
 protected:
+  std::shared_ptr<X509_STORE> storePtr;
   std::vector<std::shared_ptr<CertificateNativeImpl>> certList;
 
 public:
@@ -62,7 +71,8 @@ public:
   int setSettingsDoc(std::shared_ptr<rapidjson::Value> settingsDoc_);
 
   /* Creates a new certificate using the settings specified in the json
-   * document.
+   * document. "keyType" selects an "rsa", "ecdsa" (P-256) or "ed25519" key,
+   * ECDSA and Ed25519 keys sign TLS handshakes much faster than RSA.
    */
   int newCertificate(std::shared_ptr<Certificate> &,
                      std::shared_ptr<rapidjson::Document>);
@@ -79,6 +89,11 @@ public:
                              std::shared_ptr<rapidjson::Document>);
   int saveCertificate(std::shared_ptr<Certificate>, std::string);
   int loadCertificate(std::shared_ptr<Certificate> &);
+  /* Creates the X509 store from a PEM CA bundle instead of the system store
+   */
+  int createX509StoreFromFile(std::string);
+  /* The store created by the last createX509Store call */
+  std::shared_ptr<X509_STORE> getX509Store();
 
   // Requires some native implementation
   virtual int createX509Store() = 0;
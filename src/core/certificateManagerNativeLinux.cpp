@@ -21,6 +21,20 @@ ManagerNativeImpl::ManagerNativeImpl() {}
 ManagerNativeImpl::~ManagerNativeImpl() {}
 
 int ManagerNativeImpl::createX509Store() {
+  std::shared_ptr<X509_STORE> newStorePtr(X509_STORE_new(), X509_STORE_free);
+  if (!newStorePtr) {
+    std::cout << "ManagerImpl::createX509Store X509_STORE_new ERROR"
+              << std::endl;
+    return -1;
+  }
+  // The distribution CA bundle and hashed certificate directory
+  if (X509_STORE_set_default_paths(newStorePtr.get()) != 1) {
+    std::cout << "ManagerImpl::createX509Store X509_STORE_set_default_paths "
+                 "ERROR"
+              << std::endl;
+    return -1;
+  }
+  storePtr = newStorePtr;
   return 0;
 }
 
@@ -27,8 +27,8 @@ int ManagerNativeImpl::createX509Store() {
   certList.clear();
 
   PCCERT_CONTEXT pCertContext = NULL;
-  X509_STORE *storePtr = X509_STORE_new();
-  if (!storePtr) {
+  std::shared_ptr<X509_STORE> newStorePtr(X509_STORE_new(), X509_STORE_free);
+  if (!newStorePtr) {
     std::cout << "ManagerImpl::createX509Store X509_STORE_new ERROR"
               << std::endl;
     return -1;
@@ -58,7 +58,7 @@ int ManagerNativeImpl::createX509Store() {
       std::cout << "ManagerImpl::createX509Store toX509 ERROR" << std::endl;
       continue;
     }
-    rc = X509_STORE_add_cert(storePtr, certPtr->certX509);
+    rc = X509_STORE_add_cert(newStorePtr.get(), certPtr->certX509);
 
     if (rc < 0) {
       std::cout << "ManagerImpl::createX509Store X509_STORE_add_cert ERROR"
@@ -73,6 +73,7 @@ int ManagerNativeImpl::createX509Store() {
   }
 
   CertCloseStore(hCertStore, 0);
+  storePtr = newStorePtr;
   return 0;
 }
 
@@ -14,6 +14,8 @@
 #define BOOKFILER_HTTP_CLIENT_END_DEBUG_RESPONSE 1
 #define BOOKFILER_HTTP_CLIENT_CLIENT_DEBUG_URL 1
 #define RSA_KEY_LENGTH 2048
+// limit of response bodies kept in memory unless setMaxResponseSize was used
+#define BOOKFILER_HTTP_CLIENT_MAX_RESPONSE_SIZE 8388608
 #define BOOKFILER_MODULE_HTTP_BOOST_BEAST_EXPOSE 1
 
 // boost
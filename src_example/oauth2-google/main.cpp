@@ -111,15 +111,14 @@ int allModulesLoaded() {
   std::cout << "allModulesLoaded httpClient->url() = " << httpClient->url()
             << "\n\n";
 
-  // token url
-  httpClient->setQuery(
+  // token request form
+  httpClient->setForm(
       {{"client_id", "854776203850-r64s69l8jmh71ugiio16impqfcp80j1m.apps."
                      "googleusercontent.com"},
        {"client_secret", "18e_rRNMBIJOJ0jWUthY7RKp"},
        {"grant_type", "authorization_code"},
        {"redirect_uri", "https://localhost:8081"},
        {"code", authCode}});
-  httpClient->setHeader({{"Content-Length", "0"}});
 
   std::cout << "\n=== THREAD " << std::this_thread::get_id() << " ===\n"
             << testName << " allModulesLoaded httpClient->url():\n"